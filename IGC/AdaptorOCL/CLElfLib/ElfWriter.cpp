@@ -51,25 +51,30 @@ CElfWriter::CElfWriter(
 \******************************************************************************/
 CElfWriter::~CElfWriter()
 {
-    SSectionNode* pNode = NULL;
-
     // Walk through the section nodes
     while( m_nodeQueue.empty() == false )
     {
-        pNode = m_nodeQueue.front();
+        DeleteNode( m_nodeQueue.front() );
         m_nodeQueue.pop();
+    }
+}
 
-        // delete the node and it's data
-        if( pNode )
+/******************************************************************************\
+ Member Function: CElfWriter::DeleteNode
+ Description:     Deletes a section node and the data it owns
+\******************************************************************************/
+void CElfWriter::DeleteNode(
+    SSectionNode* pNode )
+{
+    if( pNode )
+    {
+        if( pNode->pData && pNode->OwnsData )
         {
-            if( pNode->pData )
-            {
-                delete[] pNode->pData;
-                pNode->pData = NULL;
-            }
-
-            delete pNode;
+            delete[] pNode->pData;
         }
+        pNode->pData = NULL;
+
+        delete pNode;
     }
 }
 
@@ -110,6 +115,27 @@ void CElfWriter::Delete(
 \******************************************************************************/
 E_RETVAL CElfWriter::AddSection(
     SSectionNode* pSectionNode )
+{
+    return AddSectionNode( pSectionNode, true );
+}
+
+/******************************************************************************\
+ Member Function: CElfWriter::AddSectionRef
+ Description:     Adds a section without copying its data; the data is only
+                  read once, when the binary is resolved
+\******************************************************************************/
+E_RETVAL CElfWriter::AddSectionRef(
+    SSectionNode* pSectionNode )
+{
+    return AddSectionNode( pSectionNode, false );
+}
+
+/******************************************************************************\
+ Member Function: CElfWriter::AddSectionNode
+\******************************************************************************/
+E_RETVAL CElfWriter::AddSectionNode(
+    SSectionNode* pSectionNode,
+    bool copyData )
 {
     E_RETVAL retVal = SUCCESS;
     SSectionNode* pNode = NULL;
@@ -144,16 +170,29 @@ E_RETVAL CElfWriter::AddSection(
         // ok to have NULL data
         if( dataSize > 0 )
         {
-            pNode->pData = new char[dataSize];
+            if( copyData )
+            {
+                pNode->pData = new char[dataSize];
 
-            if( pNode->pData )
+                if( pNode->pData )
+                {
+                    memcpy_s( pNode->pData, dataSize, pSectionNode->pData, dataSize );
+                    pNode->DataSize = dataSize;
+                }
+                else
+                {
+                    retVal = OUT_OF_MEMORY;
+                }
+            }
+            else if( pSectionNode->pData )
             {
-                memcpy_s( pNode->pData, dataSize, pSectionNode->pData, dataSize );
+                pNode->pData = pSectionNode->pData;
                 pNode->DataSize = dataSize;
+                pNode->OwnsData = false;
             }
             else
             {
-                retVal = OUT_OF_MEMORY;
+                retVal = FAILURE;
             }
         }
 
@@ -170,22 +209,25 @@ E_RETVAL CElfWriter::AddSection(
         else
         {
             // cleanup allocations
-            if( pNode )
-            {
-                if( pNode->pData )
-                {
-                    delete[] pNode->pData;
-                    pNode->pData = NULL;
-                }
-
-                delete pNode;
-            }
+            DeleteNode( pNode );
         }
     }
 
     return retVal;
 }
 
+/******************************************************************************\
+ Member Function: CElfWriter::GetBinarySize
+\******************************************************************************/
+size_t CElfWriter::GetBinarySize() const
+{
+    return
+        sizeof( SElf64Header ) +
+        ( ( m_numSections + 1 ) * sizeof( SElf64SectionHeader ) ) + // +1 to account for string table entry
+        m_dataSize +
+        m_stringTableSize;
+}
+
 /******************************************************************************\
  Member Function: CElfWriter::ResolveBinary
 \******************************************************************************/
@@ -200,11 +242,7 @@ E_RETVAL CElfWriter::ResolveBinary(
     char* pStringTable = NULL;
     char* pCurString = NULL;
 
-    m_totalBinarySize =
-        sizeof( SElf64Header ) +
-        ( ( m_numSections + 1 ) * sizeof( SElf64SectionHeader ) ) + // +1 to account for string table entry
-        m_dataSize +
-        m_stringTableSize;
+    m_totalBinarySize = GetBinarySize();
 
     if( pBinary )
     {
@@ -244,8 +282,11 @@ E_RETVAL CElfWriter::ResolveBinary(
                     (unsigned char*)pCurSectionHeader + sizeof( SElf64SectionHeader ) );
 
                 // copy the data, move the data pointer
-                memcpy_s( pData, pNode->DataSize, pNode->pData, pNode->DataSize );
-                pData += pNode->DataSize;
+                if( pNode->DataSize > 0 )
+                {
+                    memcpy_s( pData, pNode->DataSize, pNode->pData, pNode->DataSize );
+                    pData += pNode->DataSize;
+                }
 
                 // copy the name into the string table, move the string pointer
                 if ( pNode->Name.size() > 0 )
@@ -256,16 +297,7 @@ E_RETVAL CElfWriter::ResolveBinary(
                 *(pCurString++) = '\0';
 
                 // delete the node and it's data
-                if( pNode )
-                {
-                    if( pNode->pData )
-                    {
-                        delete[] pNode->pData;
-                        pNode->pData = NULL;
-                    }
-
-                    delete pNode;
-                }
+                DeleteNode( pNode );
             }
         }
 
@@ -50,6 +50,7 @@ struct SSectionNode
     string Name;
     char* pData;
     unsigned int DataSize;
+    bool OwnsData;   // false when pData references a caller-owned buffer
 
     SSectionNode()
     {
@@ -57,6 +58,7 @@ struct SSectionNode
         Flags    = 0;
         pData    = NULL;
         DataSize = 0;
+        OwnsData = true;
     }
 
     ~SSectionNode()
@@ -86,6 +88,15 @@ public:
     E_RETVAL ELF_CALL AddSection(
         SSectionNode* pSectionNode );
 
+    // Adds a section that references pSectionNode->pData instead of copying
+    // it. The buffer must stay valid until ResolveBinary() has been called.
+    E_RETVAL ELF_CALL AddSectionRef(
+        SSectionNode* pSectionNode );
+
+    // Returns the number of bytes ResolveBinary() will write, so the caller
+    // can emit the ELF image directly into a single buffer of its own.
+    size_t ELF_CALL GetBinarySize() const;
+
     E_RETVAL ELF_CALL ResolveBinary(
         char* const pBinary,
         size_t& dataSize );
@@ -101,6 +112,12 @@ protected:
 
     ELF_CALL ~CElfWriter();
 
+    E_RETVAL ELF_CALL AddSectionNode(
+        SSectionNode* pSectionNode,
+        bool copyData );
+
+    static void ELF_CALL DeleteNode( SSectionNode* pNode );
+
     E_EH_TYPE m_type;
     E_EH_MACHINE m_machine;
     Elf64_Xword m_flags;
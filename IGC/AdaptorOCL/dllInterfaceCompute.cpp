@@ -154,6 +154,41 @@ using namespace IGC;
 namespace TC
 {
 
+// Read-only stream buffer over memory owned by someone else. Lets SPIR-V
+// sections be parsed straight out of the ELF image instead of copying each
+// one into an std::istringstream first.
+class MemoryStreamBuf : public std::streambuf
+{
+public:
+    MemoryStreamBuf(const char* pData, size_t dataSize)
+    {
+        char* pBegin = const_cast<char*>(pData);
+        setg(pBegin, pBegin, pBegin + dataSize);
+    }
+
+protected:
+    // The SPIR-V reader rewinds the stream with tellg()/seekg()
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+        std::ios_base::openmode which = std::ios_base::in) override
+    {
+        char* pPos = (dir == std::ios_base::beg) ? eback() :
+                     (dir == std::ios_base::end) ? egptr() : gptr();
+        pPos += off;
+        if (!(which & std::ios_base::in) || pPos < eback() || pPos > egptr())
+        {
+            return pos_type(off_type(-1));
+        }
+        setg(eback(), pPos, egptr());
+        return pos_type(pPos - eback());
+    }
+
+    pos_type seekpos(pos_type pos,
+        std::ios_base::openmode which = std::ios_base::in) override
+    {
+        return seekoff(off_type(pos), std::ios_base::beg, which);
+    }
+};
+
 extern bool ProcessElfInput(
   STB_TranslateInputArgs &InputArgs,
   STB_TranslateOutputArgs &OutputArgs,
@@ -370,7 +405,8 @@ bool ProcessElfInput(
               llvm::Module* pKernelModule = nullptr;
 #if defined(IGC_SPIRV_ENABLED)
               Context.setAsSPIRV();
-              std::istringstream IS(buf);
+              MemoryStreamBuf SB(buf.data(), buf.size());
+              std::istream IS(&SB);
               std::string stringErrMsg;
               llvm::StringRef options;
               if(InputArgs.OptionsSize > 0){
@@ -1021,6 +1057,12 @@ bool TranslateBuild(
         // Now, perform code generation
         IGC::CodeGen(&oclContext);
 
+        if (!(oclContext.oclErrorMessage.empty()))
+        {
+            SetErrorMessage(oclContext.oclErrorMessage, *pOutputArgs);
+            return false;
+        }
+
         retry = (oclContext.m_retryManager.AdvanceState() &&
                 !oclContext.m_retryManager.kernelSet.empty());
 
@@ -49,6 +49,25 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
         }                                                                   \
     }
 
+// Contiguous copy done in the widest unit that the alignment of both pointers and
+// of the copy size allows. Each work-item then moves up to 16 bytes per iteration
+// and neighbouring work-items touch consecutive addresses, so the loads and stores
+// can be emitted as block messages instead of byte or dword scatters.
+#define ASYNC_WORK_GROUP_COPY_WIDE(dst_as, src_as, dst, src, num_elements, evt, __num_elements_type)  \
+    {                                                                       \
+        __num_elements_type numBytes = (num_elements) * sizeof(*(src));     \
+        size_t alignment = (size_t)(dst) | (size_t)(src) | (size_t)numBytes; \
+        if( ( alignment & 15 ) == 0 ) {                                     \
+            ASYNC_WORK_GROUP_COPY(((dst_as uint4*)(dst)), ((const src_as uint4*)(src)), numBytes / 16, evt, __num_elements_type) \
+        }                                                                   \
+        else if( ( alignment & 3 ) == 0 ) {                                 \
+            ASYNC_WORK_GROUP_COPY(((dst_as uint*)(dst)), ((const src_as uint*)(src)), numBytes / 4, evt, __num_elements_type) \
+        }                                                                   \
+        else {                                                              \
+            ASYNC_WORK_GROUP_COPY(dst, src, num_elements, evt, __num_elements_type) \
+        }                                                                   \
+    }
+
 #define ASYNC_WORK_GROUP_STRIDED_COPY_G2L(dst, src, num_elements, src_stride, evt, __num_elements_type)  \
     {                                                                       \
         __num_elements_type uiNumElements = num_elements;                                  \
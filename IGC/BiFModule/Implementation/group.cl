@@ -57,7 +57,7 @@ double OVERLOADABLE intel_sub_group_shuffle_up( double identity, double X, uint
 {                                                                                                    \
     if ( Stride == 0 )                                                                                \
     {                                                                                                \
-        ASYNC_WORK_GROUP_COPY(Destination, Source, NumElements, Event, type)                        \
+        ASYNC_WORK_GROUP_COPY_WIDE(global, local, Destination, Source, NumElements, Event, type)    \
         return Event;                                                                                \
     }                                                                                                \
     else                                                                                            \
@@ -71,7 +71,7 @@ double OVERLOADABLE intel_sub_group_shuffle_up( double identity, double X, uint
 {                                                                                                    \
     if ( Stride == 0 )                                                                                \
     {                                                                                                \
-        ASYNC_WORK_GROUP_COPY(Destination, Source, NumElements, Event, type)                        \
+        ASYNC_WORK_GROUP_COPY_WIDE(local, global, Destination, Source, NumElements, Event, type)    \
         return Event;                                                                                \
     }                                                                                                \
     else                                                                                            \
@@ -948,8 +948,8 @@ void __builtin_spirv_OpGroupWaitEvents_i32_i32_p0i64(uint Execution, uint NumEve
 {
     if (Execution == Workgroup)
     {
-        __builtin_spirv_OpControlBarrier_i32_i32_i32(Execution,0, AcquireRelease | CrossWorkgroupMemory);
-        __builtin_spirv_OpControlBarrier_i32_i32_i32(Execution,0, AcquireRelease | WorkgroupMemory );
+        // One barrier with a fence covering both global and local memory.
+        __builtin_spirv_OpControlBarrier_i32_i32_i32(Execution,0, AcquireRelease | CrossWorkgroupMemory | WorkgroupMemory);
     }
     else if (Execution == Subgroup)
     {
@@ -963,8 +963,8 @@ void __builtin_spirv_OpGroupWaitEvents_i32_i32_p4i64(uint Execution, uint NumEve
 {
     if (Execution == Workgroup)
     {
-        __builtin_spirv_OpControlBarrier_i32_i32_i32(Execution,0, AcquireRelease | CrossWorkgroupMemory);
-        __builtin_spirv_OpControlBarrier_i32_i32_i32(Execution,0, AcquireRelease | WorkgroupMemory);
+        // One barrier with a fence covering both global and local memory.
+        __builtin_spirv_OpControlBarrier_i32_i32_i32(Execution,0, AcquireRelease | CrossWorkgroupMemory | WorkgroupMemory);
     }
     else if (Execution == Subgroup)
     {
@@ -1356,81 +1356,65 @@ static half     OVERLOADABLE __intel_add(half lhs, half rhs)    { return lhs + r
 static double   OVERLOADABLE __intel_add(double lhs, double rhs) { return lhs + rhs; }
 #endif
 
-#define DEFN_WORK_GROUP_REDUCE(type, op, identity, X)                                       \
+// Work-group collectives are done in two levels: each sub-group reduces (or scans)
+// in registers, the per-sub-group partials are exchanged through SLM once and then
+// combined by another sub-group reduction. The partials are strided by the actual
+// size of the sub-group, since the last one is partial when the work-group size
+// is not a multiple of the SIMD width. The second barrier keeps a following
+// collective from overwriting the partials while they are still being read.
+#define DEFN_WORK_GROUP_REDUCE(func, type, type_abbr, op, identity, X)                      \
 {                                                                                          \
     GET_MEMPOOL_PTR(data, type, true, 0)                                                     \
-    uint lid = __spirv_BuiltInLocalInvocationIndex();                                        \
-    uint lsize = __spirv_WorkgroupSize();                                                 \
-    data[lid] = X;                                                                       \
-    __builtin_spirv_OpControlBarrier_i32_i32_i32(Execution, 0, AcquireRelease | WorkgroupMemory);         \
-    uint mask = 1 << ( ((8 * sizeof(uint)) - __builtin_spirv_OpenCL_clz_i32(lsize - 1)) - 1) ;  \
-    while( mask > 0 )                                                                    \
-    {                                                                                    \
-        uint c = lid ^ mask;                                                             \
-        type other = ( c < lsize ) ? data[ c ] : identity;                                  \
-        X = op( other, X );                                                                 \
-        __builtin_spirv_OpControlBarrier_i32_i32_i32(Workgroup, 0, AcquireRelease | WorkgroupMemory);     \
-        data[lid] = X;                                                              \
-        __builtin_spirv_OpControlBarrier_i32_i32_i32(Workgroup, 0, AcquireRelease | WorkgroupMemory);     \
-        mask >>= 1;                                                                      \
-    }                                                                                    \
-    type ret = data[0];                                                                  \
+    uint sgid = __builtin_spirv_BuiltInSubgroupId();                                        \
+    uint numsg = __builtin_spirv_BuiltInNumSubgroups();                                     \
+    uint sgsize = __builtin_spirv_BuiltInSubgroupSize();                                    \
+    uint sglid = __builtin_spirv_BuiltInSubgroupLocalInvocationId();                        \
+    X = __intel_sub_group_reduce_##func##_##type_abbr(X);                                   \
+    if( sglid == 0 )                                                                       \
+    {                                                                                      \
+        data[sgid] = X;                                                                    \
+    }                                                                                      \
+    __builtin_spirv_OpControlBarrier_i32_i32_i32(Workgroup, 0, AcquireRelease | WorkgroupMemory);         \
+    X = identity;                                                                          \
+    for( uint i = sglid; i < numsg; i += sgsize )                                           \
+    {                                                                                      \
+        X = op( X, data[i] );                                                              \
+    }                                                                                      \
+    X = __intel_sub_group_reduce_##func##_##type_abbr(X);                                   \
     __builtin_spirv_OpControlBarrier_i32_i32_i32(Workgroup, 0, AcquireRelease | WorkgroupMemory);         \
-    return ret;                                                                           \
+    return X;                                                                              \
 }
 
 
-#define DEFN_WORK_GROUP_SCAN_INCL(type, op, identity, X)                                   \
+#define DEFN_WORK_GROUP_SCAN(func, type, type_abbr, op, identity, X, inclusive)             \
 {                                                                                          \
     GET_MEMPOOL_PTR(data, type, true, 0)                                                     \
-    uint lid = __spirv_BuiltInLocalInvocationIndex();                                         \
-    uint lsize = __spirv_WorkgroupSize();                                                 \
-    data[lid] = X;                                                                       \
-    __builtin_spirv_OpControlBarrier_i32_i32_i32(Workgroup, 0,AcquireRelease |  WorkgroupMemory);         \
-    uint offset = 1;                                                                      \
-    while( offset < lsize )                                                              \
-    {                                                                                    \
-        type other = ( lid >= offset ) ?                                                  \
-                     data[ lid - offset ] :                                               \
-                     identity;                                                            \
-        X = op( X, other );                                                              \
-        __builtin_spirv_OpControlBarrier_i32_i32_i32(Workgroup, 0, AcquireRelease | WorkgroupMemory);     \
-        data[lid] = X;                                                                   \
-        __builtin_spirv_OpControlBarrier_i32_i32_i32(Workgroup, 0, AcquireRelease | WorkgroupMemory);     \
-        offset <<= 1;                                                                     \
-    }                                                                                    \
-    return X;                                                                            \
-}
-
-
-#define DEFN_WORK_GROUP_SCAN_EXCL(type, op, identity, X)                                   \
-{                                                                                         \
-    GET_MEMPOOL_PTR(data, type, true, 1)                                                 \
-    uint lid = __spirv_BuiltInLocalInvocationIndex();                                         \
-    uint lsize = __spirv_WorkgroupSize();                                                 \
-    data[0] = identity;                                                                  \
-    data[lid + 1] = X;                                                                   \
+    uint sgid = __builtin_spirv_BuiltInSubgroupId();                                        \
+    uint sgsize = __builtin_spirv_BuiltInSubgroupSize();                                    \
+    uint sglid = __builtin_spirv_BuiltInSubgroupLocalInvocationId();                        \
+    type scan = __intel_sub_group_scan_excl_##func##_##type_abbr(X);                        \
+    type total = __intel_sub_group_reduce_##func##_##type_abbr(X);                          \
+    if( sglid == 0 )                                                                       \
+    {                                                                                      \
+        data[sgid] = total;                                                                \
+    }                                                                                      \
     __builtin_spirv_OpControlBarrier_i32_i32_i32(Workgroup, 0, AcquireRelease | WorkgroupMemory);         \
-    X = data[lid];                                                                       \
-    uint offset = 1;                                                                      \
-    while( offset < lsize )                                                              \
-    {                                                                                    \
-        type other = ( lid >= offset ) ?                                                  \
-                     data[ lid - offset ] :                                               \
-                     identity;                                                            \
-        X = op( X, other );                                                              \
-        __builtin_spirv_OpControlBarrier_i32_i32_i32(Workgroup, 0, AcquireRelease | WorkgroupMemory);       \
-        data[lid] = X;                                                                   \
-        __builtin_spirv_OpControlBarrier_i32_i32_i32(Workgroup, 0, AcquireRelease | WorkgroupMemory);       \
-        offset <<= 1;                                                                    \
-    }                                                                                    \
-    return X;                                                                            \
+    type prefix = identity;                                                                \
+    for( uint i = sglid; i < sgid; i += sgsize )                                            \
+    {                                                                                      \
+        prefix = op( prefix, data[i] );                                                    \
+    }                                                                                      \
+    prefix = __intel_sub_group_reduce_##func##_##type_abbr(prefix);                         \
+    __builtin_spirv_OpControlBarrier_i32_i32_i32(Workgroup, 0, AcquireRelease | WorkgroupMemory);         \
+    scan = op( prefix, scan );                                                             \
+    return inclusive ? op( scan, X ) : scan;                                               \
 }
 
 #define DEFN_SUB_GROUP_REDUCE(type, type_abbr, op, identity, X)                             \
 {                                                                                         \
     uint sgsize = __builtin_spirv_BuiltInSubgroupSize();                                 \
-    if(sgsize == 8)    \
+    bool full = sgsize == __builtin_spirv_BuiltInSubgroupMaxSize();                      \
+    if(full && sgsize == 8)    \
     {    \
         X = op((type)intel_sub_group_shuffle( X, 0 ),    \
                 op((type)intel_sub_group_shuffle( X, 1 ),    \
@@ -1441,7 +1425,7 @@ static double   OVERLOADABLE __intel_add(double lhs, double rhs) { return lhs +
                 op((type)intel_sub_group_shuffle( X, 6 ),(type)intel_sub_group_shuffle( X, 7 )    \
                 )))))));    \
     }    \
-    else if(sgsize == 16)    \
+    else if(full && sgsize == 16)    \
     {    \
         X = op((type)intel_sub_group_shuffle( X, 0 ),    \
                 op((type)intel_sub_group_shuffle( X, 1 ),    \
@@ -1460,7 +1444,7 @@ static double   OVERLOADABLE __intel_add(double lhs, double rhs) { return lhs +
                 op((type)intel_sub_group_shuffle( X, 14 ),(type)intel_sub_group_shuffle( X, 15 )    \
                 )))))))))))))));    \
     }    \
-    else if(sgsize == 32)    \
+    else if(full && sgsize == 32)    \
     {    \
         X = op((type)intel_sub_group_shuffle( X, 0 ),    \
                 op((type)intel_sub_group_shuffle( X, 1 ),    \
@@ -1497,6 +1481,7 @@ static double   OVERLOADABLE __intel_add(double lhs, double rhs) { return lhs +
     }    \
     else    \
     {    \
+        /* partial sub-group: lanes past sgsize are inactive and read as identity */ \
         uint sglid = __builtin_spirv_BuiltInSubgroupLocalInvocationId();                     \
         uint mask = 1 << ( ((8 * sizeof(uint)) - __builtin_spirv_OpenCL_clz_i32(sgsize - 1)) - 1 ); \
         while( mask > 0 )                                                                    \
@@ -1515,19 +1500,6 @@ static double   OVERLOADABLE __intel_add(double lhs, double rhs) { return lhs +
 }
 
 
-#define DEFN_SUB_GROUP_SCAN_INCL(type, type_abbr, op, identity, X)                        \
-{                                                                                         \
-    uint sgsize = __builtin_spirv_BuiltInSubgroupSize();                                 \
-    uint offset = 1;                                                                      \
-    while( offset < sgsize )                                                             \
-    {                                                                                    \
-        type other = intel_sub_group_shuffle_up( (type)identity, X, offset );              \
-        X = op( X, other );                                                              \
-        offset <<= 1;                                                                    \
-    }                                                                                    \
-    return X;                                                                            \
-}
-
 #define DEFN_SUB_GROUP_SCAN_EXCL(type, type_abbr, op, identity, X)                        \
 {                                                                                         \
     uint sgsize = __builtin_spirv_BuiltInSubgroupSize();                                 \
@@ -1542,70 +1514,58 @@ static double   OVERLOADABLE __intel_add(double lhs, double rhs) { return lhs +
     return X;                                                                            \
 }
 
-#define WORK_GROUP_SWITCH(type, op, identity, X, Operation)                                 \
-{                                                                                         \
-    switch(Operation){                                                                     \
-        case GroupOperationReduce:                                                         \
-            DEFN_WORK_GROUP_REDUCE(type, op, identity, X)                                 \
-            break;                                                                         \
-        case GroupOperationInclusiveScan:                                                 \
-            DEFN_WORK_GROUP_SCAN_INCL(type, op, identity, X)                             \
-            break;                                                                         \
-        case GroupOperationExclusiveScan:                                                 \
-            DEFN_WORK_GROUP_SCAN_EXCL(type, op, identity, X)                             \
-            break;                                                                         \
-        default:                                                                         \
-            return 0;                                                                    \
-            break;                                                                         \
-    }                                                                                     \
-}
-
-#define SUB_GROUP_SWITCH(type, type_abbr, op, identity, X, Operation)                     \
-{                                                                                         \
-    switch(Operation){                                                                     \
-        case GroupOperationReduce:                                                         \
-            DEFN_SUB_GROUP_REDUCE(type, type_abbr, op, identity, X)                         \
-            break;                                                                         \
-        case GroupOperationInclusiveScan:                                                 \
-            DEFN_SUB_GROUP_SCAN_INCL(type, type_abbr, op, identity, X)                     \
-            break;                                                                         \
-        case GroupOperationExclusiveScan:                                                 \
-            DEFN_SUB_GROUP_SCAN_EXCL(type, type_abbr, op, identity, X)                     \
-            break;                                                                         \
-        default:                                                                         \
-            return 0;                                                                     \
-            break;                                                                         \
-    }                                                                                     \
+// Sub-group reduction and exclusive scan used by both the sub-group and the work-group
+// collectives. 64-bit types fall back to shuffles when native support is missing.
+#define DEFN_SUB_GROUP_HELPERS(func, type, type_abbr, op, identity)                              \
+static type __intel_sub_group_reduce_##func##_##type_abbr(type X)                                \
+{                                                                                                \
+    if (sizeof(X) < 8 || __UseNative64BitSubgroupBuiltin)                                        \
+    {                                                                                            \
+        return __builtin_IB_sub_group_reduce_##func##_##type_abbr(X);                            \
+    }                                                                                            \
+    DEFN_SUB_GROUP_REDUCE(type, type_abbr, op, identity, X)                                      \
+}                                                                                                \
+static type __intel_sub_group_scan_excl_##func##_##type_abbr(type X)                             \
+{                                                                                                \
+    if (sizeof(X) < 8 || __UseNative64BitSubgroupBuiltin)                                        \
+    {                                                                                            \
+        return __builtin_IB_sub_group_scan_##func##_##type_abbr(X);                              \
+    }                                                                                            \
+    DEFN_SUB_GROUP_SCAN_EXCL(type, type_abbr, op, identity, X)                                   \
 }
 
 #define DEFN_BUILTIN_SPIRV_FUNC(func, type, type_abbr, op, identity)                             \
+DEFN_SUB_GROUP_HELPERS(func, type, type_abbr, op, identity)                                      \
 type  __builtin_spirv_##func##_i32_i32_##type_abbr(uint Execution, uint Operation, type X)       \
 {                                                                                                \
     if (Execution == Workgroup)                                                                  \
     {                                                                                            \
-        WORK_GROUP_SWITCH(type, op, identity, X, Operation)                                      \
+        switch(Operation){                                                                       \
+            case GroupOperationReduce:                                                           \
+                DEFN_WORK_GROUP_REDUCE(func, type, type_abbr, op, identity, X)                   \
+            case GroupOperationInclusiveScan:                                                    \
+                DEFN_WORK_GROUP_SCAN(func, type, type_abbr, op, identity, X, true)               \
+            case GroupOperationExclusiveScan:                                                    \
+                DEFN_WORK_GROUP_SCAN(func, type, type_abbr, op, identity, X, false)              \
+            default:                                                                             \
+                return 0;                                                                        \
+        }                                                                                        \
     }                                                                                            \
     else if (Execution == Subgroup)                                                              \
-    {                                                                                             \
-        if (sizeof(X) < 8 || __UseNative64BitSubgroupBuiltin)                                            \
+    {                                                                                            \
+        if (Operation == GroupOperationReduce)                                                   \
+        {                                                                                        \
+            return __intel_sub_group_reduce_##func##_##type_abbr(X);                             \
+        }                                                                                        \
+        else if (Operation == GroupOperationInclusiveScan)                                       \
         {                                                                                        \
-            if (Operation == GroupOperationReduce)                                                     \
-            {                                                                                         \
-                return __builtin_IB_sub_group_reduce_##func##_##type_abbr(X);                         \
-            }                                                                                         \
-            else if (Operation == GroupOperationInclusiveScan)                                         \
-            {                                                                                         \
-                return op(X, __builtin_IB_sub_group_scan_##func##_##type_abbr(X));                     \
-            }                                                                                         \
-            else if (Operation == GroupOperationExclusiveScan)                                         \
-            {                                                                                         \
-                return __builtin_IB_sub_group_scan_##func##_##type_abbr(X);                           \
-            }                                                                                         \
-        }                                                                                         \
-        else {                                                                                     \
-            SUB_GROUP_SWITCH(type, type_abbr, op, identity, X, Operation)                         \
-        }                                                                                         \
-        return 0;                                                                                 \
+            return op(X, __intel_sub_group_scan_excl_##func##_##type_abbr(X));                   \
+        }                                                                                        \
+        else if (Operation == GroupOperationExclusiveScan)                                       \
+        {                                                                                        \
+            return __intel_sub_group_scan_excl_##func##_##type_abbr(X);                          \
+        }                                                                                        \
+        return 0;                                                                                \
     }                                                                                            \
     else                                                                                         \
     {                                                                                            \
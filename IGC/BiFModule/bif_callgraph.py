@@ -0,0 +1,109 @@
+#===================== begin_copyright_notice ==================================
+
+#Copyright (c) 2017 Intel Corporation
+
+#Permission is hereby granted, free of charge, to any person obtaining a
+#copy of this software and associated documentation files (the
+#"Software"), to deal in the Software without restriction, including
+#without limitation the rights to use, copy, modify, merge, publish,
+#distribute, sublicense, and/or sell copies of the Software, and to
+#permit persons to whom the Software is furnished to do so, subject to
+#the following conditions:
+
+#The above copyright notice and this permission notice shall be included
+#in all copies or substantial portions of the Software.
+
+#THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+#OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+#MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+#IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+#CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+#TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+#SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#======================= end_copyright_notice ==================================
+
+# Records the direct call graph of a BiF module so that the compiler can import
+# exactly the builtins a kernel needs without discovering them at runtime.
+#
+# The graph is appended to the textual module as named metadata:
+#   !igc.bif.callgraph = !{!N}
+#   !N = !{!"<caller> <callee> <callee> ...\0A<caller> ...\0A"}
+# Only functions defined or declared in the module are recorded as callees.
+# Names containing whitespace cannot be represented and are left out; the
+# importer still pulls such functions in through the linker.
+
+import re
+import sys
+
+def Usage () :
+  print (r'Usage: bif_callgraph.py <in.ll> <out.ll>')
+  print (r'  Appends the !igc.bif.callgraph named metadata to a disassembled BiF module.')
+
+if len(sys.argv) != 3 :
+  Usage()
+  sys.exit("Error: wrong number of arguments to bif_callgraph.py")
+
+_symbol   = r'@("(?:[^"\\]|\\.)*"|[-a-zA-Z$._0-9]+)'
+_defineRe = re.compile(r'^define\b[^@]*' + _symbol + r'\(')
+_declRe   = re.compile(r'^declare\b[^@]*' + _symbol + r'\(')
+_useRe    = re.compile(_symbol)
+_mdIdRe   = re.compile(r'^!(\d+)\s*=')
+
+def unquote(name) :
+  if name.startswith('"') :
+    name = re.sub(r'\\([0-9A-Fa-f]{2})', lambda m: chr(int(m.group(1), 16)), name[1:-1])
+  return name
+
+def escape(text) :
+  out = []
+  for c in text :
+    if c == '"' or c == '\\' or ord(c) < 0x20 or ord(c) > 0x7e :
+      out.append('\\%02X' % ord(c))
+    else :
+      out.append(c)
+  return ''.join(out)
+
+with open(sys.argv[1], 'r') as infile:
+  lines = infile.read().splitlines()
+
+functions = set()
+for line in lines :
+  m = _defineRe.match(line) or _declRe.match(line)
+  if m :
+    name = unquote(m.group(1))
+    if not re.search(r'\s', name) :
+      functions.add(name)
+
+graph = []
+maxMdId = -1
+caller = None
+callees = []
+for line in lines :
+  m = _mdIdRe.match(line)
+  if m :
+    maxMdId = max(maxMdId, int(m.group(1)))
+    continue
+  if caller is None :
+    m = _defineRe.match(line)
+    if m :
+      caller = unquote(m.group(1))
+      callees = []
+      if caller not in functions :
+        caller = None
+    continue
+  if line.startswith('}') :
+    graph.append(' '.join([caller] + callees))
+    caller = None
+    continue
+  for use in _useRe.findall(line) :
+    name = unquote(use)
+    if name in functions and name != caller and name not in callees :
+      callees.append(name)
+
+mdId = maxMdId + 1
+with open(sys.argv[2], 'w') as outfile:
+  outfile.write('\n'.join(lines))
+  outfile.write('\n\n!igc.bif.callgraph = !{!%d}\n' % mdId)
+  outfile.write('!%d = !{!"%s"}\n' % (mdId, escape('\n'.join(graph) + '\n')))
@@ -4177,7 +4177,11 @@ namespace IGC
     labelMap.clear();
     labelMap.resize(m_program->entry->size(), nullptr);
     labelCounter = 0;
-    m_hasInlineAsm = context->m_DriverInfo.SupportInlineAssembly() && context->m_instrTypes.hasInlineAsm;
+    // Inline asm is normally spliced into the kernel fragment by fragment. Only
+    // fall back to writing and reparsing the whole kernel as visaasm text when
+    // splicing is turned off.
+    m_hasInlineAsm = context->m_DriverInfo.SupportInlineAssembly() && context->m_instrTypes.hasInlineAsm &&
+        IGC_IS_FLAG_DISABLED(EnableInlineAsmSplicing);
 
     vbuilder = nullptr;
     vAsmTextBuilder = nullptr;
@@ -4195,7 +4199,10 @@ namespace IGC
     COMPILER_TIME_START(m_program->GetContext(), TIME_CG_vISACompile);
     bool enableVISADump = IGC_IS_FLAG_ENABLED(EnableVISASlowpath) || IGC_IS_FLAG_ENABLED(ShaderDumpEnable);
     auto builderMode = m_hasInlineAsm ? vISA_ASM_WRITER : vISA_3D;
-    auto builderOpt = (enableVISADump || m_hasInlineAsm) ? CM_CISA_BUILDER_BOTH : CM_CISA_BUILDER_GEN;
+    // Spliced inline asm refers to variables by name, which needs the vISA
+    // declaration lists that only the CISA path keeps.
+    bool hasInlineAsm = context->m_DriverInfo.SupportInlineAssembly() && context->m_instrTypes.hasInlineAsm;
+    auto builderOpt = (enableVISADump || hasInlineAsm) ? CM_CISA_BUILDER_BOTH : CM_CISA_BUILDER_GEN;
     V(CreateVISABuilder(vbuilder, builderMode, builderOpt, VISAPlatform, params.size(), params.data(), &m_WaTable));
 
     InitVISABuilderOptions(VISAPlatform, canAbortOnSpill, hasStackCall);
@@ -350,6 +350,9 @@ namespace IGC
 
         VISAKernel* GetVISAKernel() { return vKernel; }
         VISABuilder* GetVISABuilder() { return vbuilder; }
+        /// Whether inline asm goes through the visaasm text of the whole
+        /// kernel instead of being spliced into the kernel directly.
+        bool IsInlineAsmTextMode() const { return m_hasInlineAsm; }
         void Init();
         void Push();
 
@@ -567,8 +567,61 @@ namespace IGC
         return false;
     }
 
+    bool CComputeShader::IsSIMDModeDominated(ComputeShaderContext* ctx, SIMDMode simdMode)
+    {
+        // Forced SIMD sizes are picked before PickCSEntryEarly gets a say.
+        if (ctx->getModuleMetaData()->csInfo.forcedSIMDSize != 0 ||
+            IGC_IS_FLAG_ENABLED(ForceCSSIMD32) ||
+            IGC_IS_FLAG_ENABLED(ForceCSSIMD16) ||
+            IGC_IS_FLAG_ENABLED(ForceCSLeastSIMD))
+        {
+            return false;
+        }
+
+        float spillThreshold = ctx->GetSpillThreshold();
+        auto noSpill = [&](SIMDMode mode)
+        {
+            CShader* prog = getSIMDEntry(ctx, mode);
+            return prog && prog->ProgramOutput()->m_programSize > 0 &&
+                prog->m_spillCost <= spillThreshold;
+        };
+
+        float occu8 = ctx->GetThreadOccupancy(SIMDMode::SIMD8);
+        float occu16 = ctx->GetThreadOccupancy(SIMDMode::SIMD16);
+        float occu32 = ctx->GetThreadOccupancy(SIMDMode::SIMD32);
+
+        // Mirrors the order of checks in RetryManager::PickCSEntryEarly.
+        if (simdMode != SIMDMode::SIMD32 && noSpill(SIMDMode::SIMD32))
+        {
+            if (IGC_IS_FLAG_ENABLED(EnableHighestSIMDForNoSpill) ||
+                (occu32 >= occu16 && occu32 >= occu8))
+            {
+                return true;
+            }
+        }
+
+        if (simdMode != SIMDMode::SIMD16 && noSpill(SIMDMode::SIMD16))
+        {
+            if (IGC_IS_FLAG_ENABLED(EnableHighestSIMDForNoSpill))
+            {
+                // only a spill free SIMD32 would be picked instead
+                return simdMode == SIMDMode::SIMD8;
+            }
+            // SIMD32 wins only with occupancy at least as good as SIMD16
+            if (occu16 >= occu8 && occu16 >= occu32 &&
+                (simdMode == SIMDMode::SIMD8 || occu32 < occu16))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
     // CS codegen passes is added with below order:
     //   simd16, simd32, simd8
+    // or, when SIMD32 is expected to win:
+    //   simd32, simd16, simd8
     bool CComputeShader::CompileSIMDSize(SIMDMode simdMode, EmitPass& EP, llvm::Function& F)
     {
         if (!CompileSIMDSizeInCommon())
@@ -597,6 +650,12 @@ namespace IGC
             return false;
         }
 
+        // skip variants that cannot beat the one already compiled
+        if (IsSIMDModeDominated(ctx, simdMode))
+        {
+            return false;
+        }
+
         // skip simd32 if simd16 spills
         if (simdMode == SIMDMode::SIMD32 && simd16Program &&
             simd16Program->m_spillSize > 0)
@@ -89,6 +89,10 @@ namespace IGC
             WO_ZXY,
             WO_ZYX
         };
+        /// Returns true if an already compiled SIMD variant is certain to be
+        /// picked over simdMode by RetryManager::PickCSEntryEarly, so compiling
+        /// simdMode cannot change the result.
+        bool IsSIMDModeDominated(ComputeShaderContext* ctx, SIMDMode simdMode);
         CShader* getSIMDEntry(CodeGenContext* ctx, SIMDMode simdMode)
         {
             CShader* prog = ctx->m_retryManager.GetSIMDEntry(simdMode);
@@ -64,6 +64,7 @@ EmitPass::EmitPass(CShaderProgram::KernelShaderMap& shaders, SIMDMode mode, bool
     m_currShader(nullptr),
     m_encoder(nullptr),
     m_canAbortOnSpill(canAbortOnSpill),
+    m_encodingFailed(false),
     m_roundingMode(CEncoder::RoundingMode::RoundToNearestEven),
     m_pSignature(pSignature)
 {
@@ -452,6 +453,7 @@ bool EmitPass::runOnFunction(llvm::Function& F)
     bool ptr64bits = (m_DL->getPointerSizeInBits(ADDRESS_SPACE_PRIVATE) == 64);
     if (!m_FGA || m_FGA->isGroupHead(&F))
     {
+        m_encodingFailed = false;
         m_currShader->InitEncoder(m_SimdMode, m_canAbortOnSpill, m_ShaderMode);
         // Pre-analysis pass to be executed before call to visa builder so we can pass scratch space offset
         m_currShader->PreAnalysisPass();
@@ -561,9 +563,17 @@ bool EmitPass::runOnFunction(llvm::Function& F)
 
     phiMovToBB.clear();
     unsigned int lineNo = 0;
+    // A SIMD32 compute kernel whose temporaries would not fit twice in the
+    // register file is emitted as two interleaved SIMD16 halves right away,
+    // instead of dropping SIMD32 and only enabling slicing on a retry.
+    bool preferSlicing =
+        m_SimdMode == SIMDMode::SIMD32 &&
+        m_currShader->GetShaderType() == ShaderType::COMPUTE_SHADER &&
+        IGC_GET_FLAG_VALUE(SIMD32SlicingTempThreshold) != 0 &&
+        m_currShader->GetContext()->m_tempCount * 2 > IGC_GET_FLAG_VALUE(SIMD32SlicingTempThreshold);
     bool disableSlicing =
         IGC_IS_FLAG_ENABLED(DisableSIMD32Slicing) ||
-        !m_currShader->GetContext()->m_retryManager.AllowSimd32Slicing() ||
+        !(m_currShader->GetContext()->m_retryManager.AllowSimd32Slicing() || preferSlicing) ||
         DebugInfoData::hasDebugInfo(m_currShader) ||
         m_pattern->m_samplertoRenderTargetEnable;
 
@@ -579,7 +589,7 @@ bool EmitPass::runOnFunction(llvm::Function& F)
 
     StringRef curSrcFile, curSrcDir;
 
-    for (uint i = 0; i < m_pattern->m_numBlocks; i++)
+    for (uint i = 0; i < m_pattern->m_numBlocks && !m_encodingFailed; i++)
     {
         SBasicBlock& block = m_pattern->m_blocks[i];
         if (m_blockCoalescing->IsEmptyBlock(block.bb))
@@ -604,7 +614,7 @@ bool EmitPass::runOnFunction(llvm::Function& F)
 
         // go through the list in reverse order
         auto I = block.m_dags.rbegin(), E = block.m_dags.rend();
-        while (I != E)
+        while (I != E && !m_encodingFailed)
         {
             Instruction* llvmInst = (*I).m_root;
             if (llvmInst->getDebugLoc())
@@ -723,6 +733,18 @@ bool EmitPass::runOnFunction(llvm::Function& F)
         delete llvmtoVISADump;
     }
 
+    if (m_encodingFailed)
+    {
+        // The error is on the context already. Skip the rest of the function
+        // group and drop the kernel instead of compiling it.
+        if ((!m_FGA || m_FGA->isGroupTail(&F)) && !m_currShader->diData)
+        {
+            IF_DEBUG_INFO(IDebugEmitter::Release(m_pDebugEmitter);)
+            m_encoder->DestroyVISABuilder();
+        }
+        return false;
+    }
+
     if (!m_FGA || m_FGA->isGroupHead(&F))
     {
         // Cache the arguments list into a vector for faster access
@@ -7849,7 +7871,9 @@ bool EmitPass::validateInlineAsmConstraints(llvm::CallInst* inst, SmallVector<St
 // Example: "mul (M1, 16) $0(0, 0)<1> $1(0, 0)<1;1,0> $2(0, 0)<1;1,0>", "=r,r,r"(float %6, float %7)
 void EmitPass::EmitInlineAsm(llvm::CallInst* inst)
 {
-    std::stringstream& str = m_encoder->GetVISABuilder()->GetAsmTextStream();
+    std::stringstream asmFragment;
+    bool spliced = !m_encoder->IsInlineAsmTextMode();
+    std::stringstream& str = spliced ? asmFragment : m_encoder->GetVISABuilder()->GetAsmTextStream();
     InlineAsm* IA = cast<InlineAsm>(inst->getCalledValue());
     string asmStr = IA->getAsmString();
     smallvector<CVariable*, 8> opnds;
@@ -7934,6 +7958,14 @@ void EmitPass::EmitInlineAsm(llvm::CallInst* inst)
     str << asmStr;
     if (asmStr.back() != '\n') str << endl;
     str << "/// End Inlined ASM" << endl << endl;
+
+    if (spliced && m_encoder->GetVISAKernel()->AppendVISAInlineAsm(str.str()) != 0)
+    {
+        // The fragment can't be dropped without miscompiling the kernel, and
+        // the kernel already holds whatever part of it was appended.
+        m_currShader->GetContext()->EmitError("failed to parse inline assembly");
+        m_encodingFailed = true;
+    }
 }
 
 CVariable* EmitPass::Mul(CVariable* Src0, CVariable* Src1, const CVariable* DstPrototype)
@@ -521,6 +521,9 @@ namespace IGC
         ModuleMetaData* m_moduleMD;
 
         bool m_canAbortOnSpill;
+        /// Set when the kernel being emitted cannot be completed, e.g. its
+        /// inline asm failed to parse. Reset at the head of each function group.
+        bool m_encodingFailed;
 
         CEncoder::RoundingMode m_roundingMode;
         PSSignature* m_pSignature;
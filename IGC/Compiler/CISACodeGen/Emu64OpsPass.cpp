@@ -45,6 +45,7 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "llvm/Pass.h"
 #include "llvm/PassAnalysisSupport.h"
 #include "llvm/Analysis/TargetFolder.h"
+#include "llvm/Analysis/ValueTracking.h"
 #include "common/LLVMWarningsPop.hpp"
 
 #include "common/LLVMUtils.h"
@@ -266,6 +267,8 @@ namespace {
 
         bool preprocess(Function& F) {
             bool Changed = false;
+            // Narrow 64-bit operations whose results fit in 32 bits.
+            Changed |= narrow(F);
             // Preprocess additions with overflow.
             for (auto& BB : F) {
                 for (auto BI = BB.begin(), BE = BB.end(); BI != BE; /*EMPTY*/) {
@@ -439,6 +442,83 @@ namespace {
                 }
             }
 
+            return Changed;
+        }
+
+    private:
+        /// Check whether the low 32 bits of `BO` only depend on the low 32 bits
+        /// of its operands, so that it could be computed with 32-bit operations.
+        bool isNarrowable(BinaryOperator* BO) const {
+            switch (BO->getOpcode()) {
+            default:
+                return false;
+            case Instruction::Add:
+            case Instruction::Sub:
+            case Instruction::Mul:
+            case Instruction::And:
+            case Instruction::Or:
+            case Instruction::Xor:
+                return true;
+            case Instruction::Shl:
+                // The shift amount must be less than 32 to be valid on 32 bits.
+                return MaskedValueIsZero(BO->getOperand(1),
+                    APInt::getHighBitsSet(64, 59), *Emu->DL, 0, nullptr, BO);
+            }
+        }
+
+        /// Replace 64-bit operations by 32-bit ones when either only the low
+        /// 32 bits of the result are used, or the result is known to be a zero-
+        /// or sign-extended 32-bit value. Address computations from 32-bit
+        /// indices are the typical case, where emulating each 64-bit operation
+        /// as a pair of 32-bit ones with carry is wasted.
+        bool narrow(Function& F) {
+            // Visit users before their operands so that narrowing a user only
+            // reading the low part of its operands makes them narrowable in turn.
+            SmallVector<BinaryOperator*, 32> Candidates;
+            for (auto& BB : F)
+                for (auto& I : BB)
+                    if (auto* BO = dyn_cast<BinaryOperator>(&I))
+                        if (Emu->isInt64(BO))
+                            Candidates.push_back(BO);
+
+            bool Changed = false;
+            for (auto CI = Candidates.rbegin(), CE = Candidates.rend(); CI != CE; ++CI) {
+                BinaryOperator* BO = *CI;
+                if (!isNarrowable(BO))
+                    continue;
+
+                bool OnlyLowUsed = !BO->use_empty() &&
+                    std::all_of(BO->user_begin(), BO->user_end(), [](User* U) {
+                    return isa<TruncInst>(U) && U->getType()->getScalarSizeInBits() <= 32;
+                });
+                bool IsZExt = !OnlyLowUsed &&
+                    MaskedValueIsZero(BO, APInt::getHighBitsSet(64, 32), *Emu->DL, 0, nullptr, BO);
+                bool IsSExt = !OnlyLowUsed && !IsZExt &&
+                    ComputeNumSignBits(BO, *Emu->DL, 0, nullptr, BO) > 32;
+                if (!OnlyLowUsed && !IsZExt && !IsSExt)
+                    continue;
+
+                IRB->SetInsertPoint(BO);
+                Value* LHS = IRB->CreateTrunc(BO->getOperand(0), IRB->getInt32Ty());
+                Value* RHS = IRB->CreateTrunc(BO->getOperand(1), IRB->getInt32Ty());
+                Value* NewVal = IRB->CreateBinOp(BO->getOpcode(), LHS, RHS,
+                    Twine(BO->getName()) + ".narrow");
+
+                if (OnlyLowUsed) {
+                    for (auto UI = BO->user_begin(), UE = BO->user_end(); UI != UE; /*EMPTY*/) {
+                        TruncInst* TI = cast<TruncInst>(*UI++);
+                        TI->replaceAllUsesWith(IRB->CreateTrunc(NewVal, TI->getType()));
+                        TI->eraseFromParent();
+                    }
+                }
+                else if (IsZExt)
+                    BO->replaceAllUsesWith(IRB->CreateZExt(NewVal, BO->getType()));
+                else
+                    BO->replaceAllUsesWith(IRB->CreateSExt(NewVal, BO->getType()));
+                BO->eraseFromParent();
+                Changed = true;
+            }
+
             return Changed;
         }
     };
@@ -759,6 +839,20 @@ bool InstExpander::visitShl(BinaryOperator& BinOp) {
     Value* ShAmt = nullptr;
     std::tie(ShAmt, std::ignore) = Emu->getExpandedValues(BinOp.getOperand(1));
 
+    if (!isa<ConstantInt>(ShAmt) &&
+        MaskedValueIsZero(BinOp.getOperand(1), APInt::getHighBitsSet(64, 59),
+            *Emu->DL, 0, nullptr, &BinOp)) {
+        // `ShAmt` is known to be less than 32, e.g. an index scaled by a
+        // variable element size. Shift both halves in place without branches;
+        // `(Lo >> 1) >> (31 - ShAmt)` is still defined when `ShAmt` is zero.
+        Value* L = IRB->CreateShl(Lo, ShAmt);
+        Value* T0 = IRB->CreateLShr(IRB->CreateLShr(Lo, 1),
+            IRB->CreateSub(IRB->getInt32(31), ShAmt));
+        Value* H = IRB->CreateOr(IRB->CreateShl(Hi, ShAmt), T0);
+        Emu->setExpandedValues(&BinOp, L, H);
+        return true;
+    }
+
     BasicBlock* OldBB = BinOp.getParent();
     BasicBlock* InnerTBB = nullptr;
     BasicBlock* InnerFBB = nullptr;
@@ -41,8 +41,10 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SCCIterator.h"
+#include "llvm/Analysis/LoopInfo.h"
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/IR/CallSite.h"
+#include "llvm/IR/Dominators.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Instructions.h"
@@ -770,13 +772,27 @@ namespace {
     class SubroutineInliner : public LegacyInlinerBase {
         EstimateFunctionSize* FSA;
 
+        /// Loop info of the last caller queried, and its block count when it
+        /// was computed. Inlining a callee with more than one block adds
+        /// blocks to the caller, so a changed count means a stale loop info.
+        const Function* LoopInfoFunc;
+        unsigned LoopInfoNumBlocks;
+        LoopInfo LI;
+
+        /// Size of each caller, charged with the callees inlined into it for
+        /// being called from a loop.
+        DenseMap<const Function*, std::size_t> CallerSizes;
+
+        std::size_t getCallSiteWeight(CallSite CS);
+        std::size_t getCallerSize(const Function* Caller);
+
     public:
         static char ID; // Pass identification, replacement for typeid
 
         // Use extremely low threshold.
         SubroutineInliner()
             : LegacyInlinerBase(ID, /*InsertLifetime*/ false),
-            FSA(nullptr) {}
+            FSA(nullptr), LoopInfoFunc(nullptr), LoopInfoNumBlocks(0) {}
 
         InlineCost getInlineCost(CallSite CS) override;
 
@@ -785,6 +801,9 @@ namespace {
 
         using llvm::Pass::doFinalization;
         bool doFinalization(CallGraph& CG) override {
+            LoopInfoFunc = nullptr;
+            LI.releaseMemory();
+            CallerSizes.clear();
             return removeDeadFunctions(CG);
         }
     };
@@ -811,6 +830,35 @@ bool SubroutineInliner::runOnSCC(CallGraphSCC& SCC)
     return LegacyInlinerBase::runOnSCC(SCC);
 }
 
+/// \brief Return the estimated execution frequency of a call site relative to
+/// its caller entry, derived from its loop depth in the current caller body.
+std::size_t SubroutineInliner::getCallSiteWeight(CallSite CS)
+{
+    Function* Caller = CS.getCaller();
+    if (Caller != LoopInfoFunc || Caller->size() != LoopInfoNumBlocks)
+    {
+        DominatorTree DT(*Caller);
+        LI.releaseMemory();
+        LI.analyze(DT);
+        LoopInfoFunc = Caller;
+        LoopInfoNumBlocks = Caller->size();
+    }
+    unsigned Depth = std::min(LI.getLoopDepth(CS.getInstruction()->getParent()), 2U);
+    return std::size_t(1) << (3 * Depth);
+}
+
+std::size_t SubroutineInliner::getCallerSize(const Function* Caller)
+{
+    auto I = CallerSizes.find(Caller);
+    if (I != CallerSizes.end())
+        return I->second;
+    std::size_t Size = std::accumulate(
+        Caller->begin(), Caller->end(), std::size_t(0),
+        [](std::size_t s, const BasicBlock& BB) { return BB.size() + s; });
+    CallerSizes[Caller] = Size;
+    return Size;
+}
+
 /// \brief Get the inline cost for the subroutine-inliner.
 ///
 InlineCost SubroutineInliner::getInlineCost(CallSite CS)
@@ -862,6 +910,23 @@ InlineCost SubroutineInliner::getInlineCost(CallSite CS)
             if (FSA->getExpandedSize(Caller) <= Threshold ||
                 FSA->onlyCalledOnce(Callee) || isTrivialCall(Callee))
                 return IGCLLVM::InlineCost::getAlways();
+
+            // Calls in loops pay the stack call overhead on every iteration,
+            // so larger callees are still worth inlining there, as long as
+            // the caller stays under the size that enabled subroutines.
+            std::size_t Budget = IGC_GET_FLAG_VALUE(SubroutineThreshold);
+            std::size_t CalleeSize = FSA->getExpandedSize(Callee);
+            std::size_t CallerSize = getCallerSize(Caller);
+            if (CallerSize < Budget && CalleeSize <= Budget - CallerSize)
+            {
+                std::size_t Weight = getCallSiteWeight(CS);
+                if (Weight > 1 && CalleeSize <=
+                    Weight * IGC_GET_FLAG_VALUE(SubroutineHotCallInlineThreshold))
+                {
+                    CallerSizes[Caller] = CallerSize + CalleeSize;
+                    return IGCLLVM::InlineCost::getAlways();
+                }
+            }
         }
     }
 
@@ -39,6 +39,7 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "llvmWrapper/IR/IRBuilder.h"
 
 #include <llvm/IR/Function.h>
+#include <llvm/Analysis/LoopInfo.h>
 #include <llvm/IR/Instructions.h>
 #include <llvm/ADT/SmallVector.h>
 #include "common/LLVMWarningsPop.hpp"
@@ -72,6 +73,7 @@ namespace IGC {
             AU.addRequired<MetaDataUtilsWrapper>();
             AU.addRequired<CodeGenContextWrapper>();
             AU.addRequired<WIAnalysis>();
+            AU.addRequired<llvm::LoopInfoWrapperPass>();
             AU.setPreservesCFG();
         }
 
@@ -87,7 +89,12 @@ namespace IGC {
             llvm::Type* pBaseType);
         void handleAllocaInst(llvm::AllocaInst* pAlloca);
 
-        bool CheckIfAllocaPromotable(llvm::AllocaInst* pAlloca);
+        /// Record the alloca in m_candidates if it can be promoted to registers.
+        void CollectPromotionCandidate(llvm::AllocaInst* pAlloca);
+        /// Pick the candidates to promote, most frequently accessed first, as long
+        /// as the estimated register pressure stays within the GRF budget.
+        void SelectAllocasToPromote();
+        bool FitsInRegisterBudget(llvm::AllocaInst* pAlloca, unsigned int allocaSize);
         bool IsNativeType(Type* type);
         /// Conservatively check if a store allow an Alloca to be uniform
         bool IsUniformStore(llvm::StoreInst* pStore);
@@ -112,6 +119,20 @@ namespace IGC {
         };
 
         std::vector<PromotedLiverange> m_promotedLiveranges;
+
+        struct PromotionCandidate
+        {
+            llvm::AllocaInst* pAlloca;
+            unsigned int allocaSize;
+            /// Loop-depth weighted number of accesses per byte
+            float benefit;
+            /// Small enough to be promoted without checking the register budget
+            bool bypassBudget;
+        };
+
+        /// Allocas that may be promoted if the register budget allows it
+        std::vector<PromotionCandidate> m_candidates;
+        float m_grfRatio;
     };
 
     FunctionPass* createPromotePrivateArrayToReg()
@@ -129,6 +150,7 @@ IGC_INITIALIZE_PASS_BEGIN(LowerGEPForPrivMem, PASS_FLAG, PASS_DESCRIPTION, PASS_
 IGC_INITIALIZE_PASS_DEPENDENCY(RegisterPressureEstimate)
 IGC_INITIALIZE_PASS_DEPENDENCY(MetaDataUtilsWrapper)
 IGC_INITIALIZE_PASS_DEPENDENCY(CodeGenContextWrapper)
+IGC_INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
 IGC_INITIALIZE_PASS_END(LowerGEPForPrivMem, PASS_FLAG, PASS_DESCRIPTION, PASS_CFG_ONLY, PASS_ANALYSIS)
 
 char LowerGEPForPrivMem::ID = 0;
@@ -167,9 +189,13 @@ bool LowerGEPForPrivMem::runOnFunction(llvm::Function& F)
     m_pRegisterPressureEstimate = &getAnalysis<RegisterPressureEstimate>();
     m_pRegisterPressureEstimate->buildRPMapPerInstruction();
     m_allocasToPrivMem.clear();
+    m_candidates.clear();
+    m_promotedLiveranges.clear();
 
     visit(F);
 
+    SelectAllocasToPromote();
+
     std::vector<llvm::AllocaInst*>& allocaToHande = m_allocasToPrivMem;
     for (auto pAlloca : allocaToHande)
     {
@@ -225,6 +251,25 @@ static void GetAllocaLiverange(Instruction* I, unsigned int& liverangeStart, uns
     }
 }
 
+/// Number of loads and stores of the alloca, each weighted by 8^(loop depth)
+static float GetAllocaAccessWeight(Instruction* I, LoopInfo* LI)
+{
+    float weight = 0.0f;
+    for (auto* U : I->users())
+    {
+        if (isa<GetElementPtrInst>(U) || isa<BitCastInst>(U))
+        {
+            weight += GetAllocaAccessWeight(cast<Instruction>(U), LI);
+        }
+        else if (isa<LoadInst>(U) || isa<StoreInst>(U))
+        {
+            unsigned int depth = std::min(LI->getLoopDepth(cast<Instruction>(U)->getParent()), 4u);
+            weight += (float)(1u << (3 * depth));
+        }
+    }
+    return weight;
+}
+
 bool LowerGEPForPrivMem::IsNativeType(Type* type)
 {
     if ((type->isDoubleTy() && !m_ctx->platform.supportFP64()) ||
@@ -235,7 +280,7 @@ bool LowerGEPForPrivMem::IsNativeType(Type* type)
     return true;
 }
 
-bool LowerGEPForPrivMem::CheckIfAllocaPromotable(llvm::AllocaInst* pAlloca)
+void LowerGEPForPrivMem::CollectPromotionCandidate(llvm::AllocaInst* pAlloca)
 {
     auto WI = &getAnalysis<WIAnalysis>();
     bool isUniformAlloca = WI->whichDepend(pAlloca) == WIAnalysis::UNIFORM;
@@ -251,6 +296,7 @@ bool LowerGEPForPrivMem::CheckIfAllocaPromotable(llvm::AllocaInst* pAlloca)
     // scale alloc size based on the number of GRFs we have
     float grfRatio = m_ctx->getNumGRFPerThread() / 128.0f;
     allowedAllocaSizeInBytes = (uint32_t)(allowedAllocaSizeInBytes * grfRatio);
+    m_grfRatio = grfRatio;
 
     if (m_ctx->type == ShaderType::COMPUTE_SHADER)
     {
@@ -263,11 +309,11 @@ bool LowerGEPForPrivMem::CheckIfAllocaPromotable(llvm::AllocaInst* pAlloca)
     Type* baseType = nullptr;
     if (!CanUseSOALayout(pAlloca, baseType))
     {
-        return false;
+        return;
     }
     if (!IsNativeType(baseType))
     {
-        return false;
+        return;
     }
     if (isUniformAlloca)
     {
@@ -276,16 +322,58 @@ bool LowerGEPForPrivMem::CheckIfAllocaPromotable(llvm::AllocaInst* pAlloca)
         allocaSize = iSTD::Round(allocaSize, 8) / 8;
     }
 
-    if (allocaSize <= IGC_GET_FLAG_VALUE(ByPassAllocaSizeHeuristic))
+    PromotionCandidate candidate;
+    candidate.pAlloca = pAlloca;
+    candidate.allocaSize = allocaSize;
+    candidate.benefit = 0.0f;
+    candidate.bypassBudget = allocaSize <= IGC_GET_FLAG_VALUE(ByPassAllocaSizeHeuristic);
+
+    // if alloca size exceeds alloc size threshold, it stays in private memory
+    if (!candidate.bypassBudget && allocaSize > allowedAllocaSizeInBytes)
     {
-        return true;
+        return;
     }
 
-    // if alloca size exceeds alloc size threshold, return false
-    if (allocaSize > allowedAllocaSizeInBytes)
+    // the register budget is checked in SelectAllocasToPromote once all the
+    // candidates of the function are known
+    if (!candidate.bypassBudget)
     {
-        return false;
+        candidate.benefit = GetAllocaAccessWeight(pAlloca, &getAnalysis<LoopInfoWrapperPass>().getLoopInfo()) /
+            std::max(allocaSize, 1u);
     }
+    m_candidates.push_back(candidate);
+}
+
+void LowerGEPForPrivMem::SelectAllocasToPromote()
+{
+    for (auto& candidate : m_candidates)
+    {
+        if (candidate.bypassBudget)
+        {
+            m_allocasToPrivMem.push_back(candidate.pAlloca);
+        }
+    }
+
+    // Hot allocas claim the budget first, so that a large array accessed once at
+    // the top of the kernel cannot push a small one used in a loop to scratch.
+    std::stable_sort(m_candidates.begin(), m_candidates.end(),
+        [](const PromotionCandidate& lhs, const PromotionCandidate& rhs)
+    {
+        return lhs.benefit > rhs.benefit;
+    });
+
+    for (auto& candidate : m_candidates)
+    {
+        if (!candidate.bypassBudget &&
+            FitsInRegisterBudget(candidate.pAlloca, candidate.allocaSize))
+        {
+            m_allocasToPrivMem.push_back(candidate.pAlloca);
+        }
+    }
+}
+
+bool LowerGEPForPrivMem::FitsInRegisterBudget(AllocaInst* pAlloca, unsigned int allocaSize)
+{
     // if no live range info
     if (!m_pRegisterPressureEstimate->isAvailable())
     {
@@ -299,7 +387,7 @@ bool LowerGEPForPrivMem::CheckIfAllocaPromotable(llvm::AllocaInst* pAlloca)
 
     GetAllocaLiverange(pAlloca, lowestAssignedNumber, highestAssignedNumber, m_pRegisterPressureEstimate);
 
-    uint32_t maxGRFPressure = (uint32_t)(grfRatio * MAX_PRESSURE_GRF_NUM * 4);
+    uint32_t maxGRFPressure = (uint32_t)(m_grfRatio * MAX_PRESSURE_GRF_NUM * 4);
 
     unsigned int pressure = 0;
     for (unsigned int i = lowestAssignedNumber; i <= highestAssignedNumber; i++)
@@ -458,12 +546,7 @@ void LowerGEPForPrivMem::visitAllocaInst(AllocaInst& I)
 {
     // Alloca should always be private memory
     assert(I.getType()->getAddressSpace() == ADDRESS_SPACE_PRIVATE);
-    if (!CheckIfAllocaPromotable(&I))
-    {
-        // alloca size extends remain per-lane-reg space
-        return;
-    }
-    m_allocasToPrivMem.push_back(&I);
+    CollectPromotionCandidate(&I);
 }
 
 void TransposeHelper::HandleAllocaSources(Instruction* v, Value* idx)
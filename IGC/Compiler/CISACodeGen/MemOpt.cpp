@@ -24,14 +24,19 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 ======================= end_copyright_notice ==================================*/
 #include "common/LLVMWarningsPush.hpp"
+#include <llvm/ADT/SmallPtrSet.h>
 #include <llvm/ADT/STLExtras.h>
 #include <llvmWrapper/Analysis/MemoryLocation.h>
 #include <llvm/Analysis/AliasAnalysis.h>
 #include <llvm/Analysis/InstructionSimplify.h>
+#include <llvm/Analysis/LoopInfo.h>
+#include <llvm/Analysis/PostDominators.h>
 #include <llvm/Analysis/ScalarEvolution.h>
 #include <llvm/Analysis/ScalarEvolutionExpressions.h>
 #include <llvm/Analysis/ValueTracking.h>
+#include <llvm/IR/CFG.h>
 #include <llvm/IR/DataLayout.h>
+#include <llvm/IR/Dominators.h>
 #include <llvm/IR/Function.h>
 #include <llvm/IR/GlobalAlias.h>
 #include <llvm/IR/IRBuilder.h>
@@ -69,12 +74,18 @@ namespace {
     //   after the other one in the program order) are safe to be merged, i.e.
     //   the non-tailing store is merged into the tailing one, iff there's no
     //   memory dependency between them which may results in different result.
+    // - Before that, a load in a block is moved next to a mergeable load in the
+    //   control-equivalent block dominating it (e.g. the loads before and after
+    //   an if/else region) so that the two can be merged as above.
     //
     class MemOpt : public FunctionPass {
         const DataLayout* DL;
         AliasAnalysis* AA;
         ScalarEvolution* SE;
         WIAnalysis* WI;
+        DominatorTree* DT;
+        PostDominatorTree* PDT;
+        LoopInfo* LI;
 
         CodeGenContext* CGC;
         TargetLibraryInfo* TLI;
@@ -95,7 +106,7 @@ namespace {
 
         MemOpt() :
             FunctionPass(ID), DL(nullptr), AA(nullptr), SE(nullptr), WI(nullptr),
-            CGC(nullptr) {
+            DT(nullptr), PDT(nullptr), LI(nullptr), CGC(nullptr) {
             initializeMemOptPass(*PassRegistry::getPassRegistry());
         }
 
@@ -110,10 +121,17 @@ namespace {
             AU.addRequired<TargetLibraryInfoWrapperPass>();
             AU.addRequired<ScalarEvolutionWrapperPass>();
             AU.addRequired<WIAnalysis>();
+            AU.addRequired<DominatorTreeWrapperPass>();
+            AU.addRequired<PostDominatorTreeWrapperPass>();
+            AU.addRequired<LoopInfoWrapperPass>();
         }
 
         void buildProfitVectorLengths(Function& F);
 
+        bool hoistLoadsAcrossBlocks(Function& F);
+        bool hoistLoad(LoadInst* Ld, BasicBlock* LeadingBB,
+            SmallVectorImpl<Instruction*>& CheckList);
+
         bool mergeLoad(LoadInst* LeadingLoad, MemRefListTy::iterator MI,
             MemRefListTy& MemRefs, TrivialMemRefListTy& ToOpt);
         bool mergeStore(StoreInst* LeadingStore, MemRefListTy::iterator MI,
@@ -368,6 +386,9 @@ IGC_INITIALIZE_PASS_DEPENDENCY(MetaDataUtilsWrapper)
 IGC_INITIALIZE_PASS_DEPENDENCY(AAResultsWrapperPass)
 IGC_INITIALIZE_PASS_DEPENDENCY(TargetLibraryInfoWrapperPass)
 IGC_INITIALIZE_PASS_DEPENDENCY(WIAnalysis)
+IGC_INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
+IGC_INITIALIZE_PASS_DEPENDENCY(PostDominatorTreeWrapperPass)
+IGC_INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
 IGC_INITIALIZE_PASS_END(MemOpt, PASS_FLAG, PASS_DESC, PASS_CFG_ONLY, PASS_ANALYSIS)
 
 char MemOpt::ID = 0;
@@ -408,6 +429,9 @@ bool MemOpt::runOnFunction(Function& F) {
     AA = &getAnalysis<AAResultsWrapperPass>().getAAResults();
     SE = &getAnalysis<ScalarEvolutionWrapperPass>().getSE();
     WI = &getAnalysis<WIAnalysis>();
+    DT = &getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+    PDT = &getAnalysis<PostDominatorTreeWrapperPass>().getPostDomTree();
+    LI = &getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
 
     CGC = getAnalysis<CodeGenContextWrapper>().getCodeGenContext();
     TLI = &getAnalysis<TargetLibraryInfoWrapperPass>().getTLI();
@@ -417,6 +441,9 @@ bool MemOpt::runOnFunction(Function& F) {
 
     bool Changed = false;
 
+    if (IGC_IS_FLAG_ENABLED(EnableMemOptAcrossBlocks))
+        Changed |= hoistLoadsAcrossBlocks(F);
+
     for (Function::iterator BB = F.begin(), BBE = F.end(); BB != BBE; ++BB) {
         // Find all instructions with memory reference. Remember the distance one
         // by one.
@@ -470,6 +497,155 @@ bool MemOpt::runOnFunction(Function& F) {
     return Changed;
 }
 
+/// hoistLoadsAcrossBlocks() - for each block, moves the loads of its
+/// control-equivalent successor (its immediate post-dominator, if dominated by
+/// it) next to a load in that block they can be merged with. As the successor
+/// always runs when the block runs, this never introduces a new access.
+/// A load is moved across at most MemOptAcrossBlocksDistance instructions, as
+/// it stays live across all of them.
+bool MemOpt::hoistLoadsAcrossBlocks(Function& F) {
+    bool Changed = false;
+    unsigned MaxDistance = IGC_GET_FLAG_VALUE(MemOptAcrossBlocksDistance);
+
+    for (auto& BB : F) {
+        DomTreeNode* Node = PDT->getNode(&BB);
+        if (!Node || !Node->getIDom())
+            continue;
+        BasicBlock* Succ = Node->getIDom()->getBlock();
+        if (!Succ || !DT->dominates(&BB, Succ) ||
+            LI->getLoopFor(&BB) != LI->getLoopFor(Succ))
+            continue;
+        auto IsLoad = [](Instruction& I) { return isa<LoadInst>(I); };
+        if (std::none_of(BB.begin(), BB.end(), IsLoad) ||
+            std::none_of(Succ->begin(), Succ->end(), IsLoad))
+            continue;
+
+        // Instructions between the end of BB and the current load of Succ,
+        // i.e. the blocks on the paths from BB to Succ, which post-dominates
+        // BB. Give up on regions longer than the hoisting distance.
+        SmallVector<Instruction*, 16> CheckList;
+        SmallVector<BasicBlock*, 8> Worklist(succ_begin(&BB), succ_end(&BB));
+        SmallPtrSet<BasicBlock*, 8> Visited;
+        unsigned Distance = 0;
+        while (!Worklist.empty() && Distance <= MaxDistance) {
+            BasicBlock* Other = Worklist.pop_back_val();
+            if (Other == Succ || !Visited.insert(Other).second)
+                continue;
+            Distance += Other->size();
+            for (auto& I : *Other)
+                if (I.mayReadOrWriteMemory())
+                    CheckList.push_back(&I);
+            Worklist.append(succ_begin(Other), succ_end(Other));
+        }
+
+        for (auto II = Succ->begin(), IE = Succ->end();
+            II != IE && Distance <= MaxDistance; ++Distance) {
+            Instruction* I = &*II++;
+            if (!I->mayReadOrWriteMemory())
+                continue;
+            LoadInst* Ld = dyn_cast<LoadInst>(I);
+            if (!Ld || shouldSkip(Ld) || !hoistLoad(Ld, &BB, CheckList))
+                CheckList.push_back(I);
+            else
+                Changed = true;
+        }
+    }
+
+    return Changed;
+}
+
+/// hoistLoad() - moves the load `Ld` right after a load from `LeadingBB` it is
+/// expected to be merged with, if no instruction in the check list or after
+/// that leading load may write the loaded location.
+bool MemOpt::hoistLoad(LoadInst* Ld, BasicBlock* LeadingBB,
+    SmallVectorImpl<Instruction*>& CheckList) {
+    if (!Ld->isSimple() || !Ld->isUnordered() || Ld->getType()->isPointerTy())
+        return false;
+
+    Type* ScalarTy = Ld->getType()->getScalarType();
+    unsigned TypeSizeInBits = unsigned(DL->getTypeSizeInBits(ScalarTy));
+    if (!ProfitVectorLengths.count(TypeSizeInBits))
+        return false;
+    unsigned ScalarSize = unsigned(DL->getTypeStoreSize(ScalarTy));
+    unsigned MaxSize = ProfitVectorLengths[TypeSizeInBits][0] * ScalarSize;
+    unsigned LdSize = unsigned(DL->getTypeStoreSize(Ld->getType()));
+
+    const SCEV* Ptr = SE->getSCEV(Ld->getPointerOperand());
+    if (isa<SCEVCouldNotCompute>(Ptr))
+        return false;
+
+    // Scan backward so that the closest leading load is preferred, collecting
+    // the instructions it would be moved across.
+    SmallVector<Instruction*, 8> LocalCheckList(CheckList.begin(), CheckList.end());
+    unsigned Limit = IGC_GET_FLAG_VALUE(MemOptWindowSize);
+    for (auto II = LeadingBB->rbegin(), IE = LeadingBB->rend();
+        II != IE && Limit != 0; ++II, --Limit) {
+        Instruction* I = &*II;
+        if (!I->mayReadOrWriteMemory())
+            continue;
+        LoadInst* LeadingLd = dyn_cast<LoadInst>(I);
+        if (!LeadingLd || shouldSkip(LeadingLd) || !LeadingLd->isSimple() ||
+            LeadingLd->getPointerAddressSpace() != Ld->getPointerAddressSpace() ||
+            !hasSameSize(LeadingLd->getType()->getScalarType(), ScalarTy)) {
+            LocalCheckList.push_back(I);
+            continue;
+        }
+
+        const SCEVConstant* Offset = dyn_cast<SCEVConstant>(
+            SE->getMinusSCEV(Ptr, SE->getSCEV(LeadingLd->getPointerOperand())));
+        if (!Offset) {
+            LocalCheckList.push_back(I);
+            continue;
+        }
+        int64_t Off = Offset->getValue()->getSExtValue();
+        int64_t LeadingSize = DL->getTypeStoreSize(LeadingLd->getType());
+        int64_t Span = std::max<int64_t>(Off + LdSize, LeadingSize) -
+            std::min<int64_t>(Off, 0);
+        // Same location, or too far apart to fit in a single message.
+        if (Off == 0 || Span > MaxSize || Span % ScalarSize != 0) {
+            LocalCheckList.push_back(I);
+            continue;
+        }
+        // Unaligned non-uniform accesses are only merged within a dword, see
+        // checkAlignmentBeforeMerge().
+        if (std::min(Ld->getAlignment(), LeadingLd->getAlignment()) < 4 &&
+            WI->whichDepend(LeadingLd) != WIAnalysis::UNIFORM)
+            return false;
+        if (!isSafeToMergeLoad(Ld, LocalCheckList))
+            return false;
+
+        // Address the hoisted load from the leading pointer, which is
+        // available there, instead of moving its own address computation.
+        IRBuilder<> Builder(LeadingLd->getNextNode());
+        unsigned AS = Ld->getPointerAddressSpace();
+        Value* NewPtr =
+            Builder.CreateBitCast(LeadingLd->getPointerOperand(),
+                Builder.getInt8PtrTy(AS));
+        NewPtr = Builder.CreateGEP(NewPtr, Builder.getInt64(Off));
+        NewPtr = Builder.CreateBitCast(NewPtr, Ld->getPointerOperandType());
+        Instruction* NewLd = Ld->clone();
+        NewLd->setOperand(Ld->getPointerOperandIndex(), NewPtr);
+        Builder.Insert(NewLd);
+
+        // The new address is the leading one plus a constant.
+        Value* LeadingPtr = LeadingLd->getPointerOperand();
+        WIBaseClass::WIDependancy PtrDep = WI->whichDepend(LeadingPtr);
+        for (Value* V = NewPtr; V != LeadingPtr && isa<Instruction>(V);
+            V = cast<Instruction>(V)->getOperand(0))
+            WI->incUpdateDepend(V, PtrDep);
+        WI->incUpdateDepend(NewLd, WI->whichDepend(Ld));
+
+        // The old address computation is left to DCE as it may involve
+        // instructions in the check list.
+        NewLd->takeName(Ld);
+        Ld->replaceAllUsesWith(NewLd);
+        Ld->eraseFromParent();
+        return true;
+    }
+
+    return false;
+}
+
 bool MemOpt::mergeLoad(LoadInst* LeadingLoad,
     MemRefListTy::iterator MI, MemRefListTy& MemRefs,
     TrivialMemRefListTy& ToOpt) {
@@ -0,0 +1,308 @@
+/*===================== begin_copyright_notice ==================================
+
+Copyright (c) 2017 Intel Corporation
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+======================= end_copyright_notice ==================================*/
+
+#define DEBUG_TYPE "phase-remat"
+#include "common/LLVMUtils.h"
+
+#include "Compiler/CISACodeGen/PhaseRemat.h"
+#include "Compiler/CISACodeGen/RegisterPressureEstimate.hpp"
+#include "Compiler/CodeGenContextWrapper.hpp"
+#include "Compiler/CodeGenPublic.h"
+#include "Compiler/MetaDataUtilsWrapper.h"
+#include "Compiler/IGCPassSupport.h"
+
+#include "common/LLVMWarningsPush.hpp"
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/ADT/MapVector.h>
+#include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/Analysis/LoopInfo.h>
+#include <llvm/IR/DataLayout.h>
+#include <llvm/IR/Dominators.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/Pass.h>
+#include <llvm/Transforms/Utils/Local.h>
+#include <llvm/Transforms/Utils/ValueMapper.h>
+#include "common/LLVMWarningsPop.hpp"
+
+using namespace llvm;
+using namespace IGC;
+using namespace IGC::IGCMD;
+
+namespace {
+
+    class PhaseRemat : public FunctionPass {
+        DominatorTree* DT;
+        LoopInfo* LI;
+        RegisterPressureEstimate* RPE;
+        const DataLayout* DL;
+
+        /// Number of instructions numbered below N whose register pressure,
+        /// in bytes per lane, exceeds the budget.
+        SmallVector<unsigned, 256> PeaksBefore;
+        /// Highest pressure a SIMD16 kernel can afford without spilling.
+        unsigned Budget;
+
+        /// The RPE numbering and live ranges do not account for the clones
+        /// inserted, so a block is given at most one recomputed expression and
+        /// the clones themselves are never looked up.
+        DenseSet<BasicBlock*> RematBlocks;
+        SmallPtrSet<Instruction*, 32> Clones;
+
+        /// Maximal number of instructions recomputed for a single use.
+        static const unsigned MaxExprSize = 4;
+
+    public:
+        static char ID;
+
+        PhaseRemat() : FunctionPass(ID), DT(nullptr), LI(nullptr), RPE(nullptr),
+            DL(nullptr), Budget(0) {
+            initializePhaseRematPass(*PassRegistry::getPassRegistry());
+        }
+
+        bool runOnFunction(Function&) override;
+
+        void getAnalysisUsage(AnalysisUsage& AU) const override {
+            AU.setPreservesCFG();
+            AU.addRequired<DominatorTreeWrapperPass>();
+            AU.addRequired<LoopInfoWrapperPass>();
+            AU.addRequired<RegisterPressureEstimate>();
+            AU.addRequired<CodeGenContextWrapper>();
+            AU.addRequired<MetaDataUtilsWrapper>();
+        }
+
+    private:
+        bool isLiveAt(Value* V, unsigned N) const;
+        bool crossesPeak(unsigned From, unsigned To) const;
+        bool collectExpr(Instruction* I, Instruction* InsertPt, unsigned N,
+            SmallVectorImpl<Instruction*>& Expr, unsigned& ExtendedBytes) const;
+        bool reMaterialize(Instruction* I);
+    };
+
+} // End anonymous namespace
+
+FunctionPass* IGC::createPhaseRematPass() {
+    return new PhaseRemat();
+}
+
+char PhaseRemat::ID = 0;
+
+#define PASS_FLAG     "igc-phase-remat"
+#define PASS_DESC     "Rematerialize values live across register pressure peaks"
+#define PASS_CFG_ONLY false
+#define PASS_ANALYSIS false
+namespace IGC {
+    IGC_INITIALIZE_PASS_BEGIN(PhaseRemat, PASS_FLAG, PASS_DESC, PASS_CFG_ONLY, PASS_ANALYSIS)
+        IGC_INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
+        IGC_INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
+        IGC_INITIALIZE_PASS_DEPENDENCY(RegisterPressureEstimate)
+        IGC_INITIALIZE_PASS_DEPENDENCY(CodeGenContextWrapper)
+        IGC_INITIALIZE_PASS_DEPENDENCY(MetaDataUtilsWrapper)
+        IGC_INITIALIZE_PASS_END(PhaseRemat, PASS_FLAG, PASS_DESC, PASS_CFG_ONLY, PASS_ANALYSIS)
+}
+
+bool PhaseRemat::runOnFunction(Function& F) {
+    // Skip non-kernel function.
+    MetaDataUtils* MDU = getAnalysis<MetaDataUtilsWrapper>().getMetaDataUtils();
+    auto FII = MDU->findFunctionsInfoItem(&F);
+    if (FII == MDU->end_FunctionsInfo())
+        return false;
+
+    RPE = &getAnalysis<RegisterPressureEstimate>();
+    if (!RPE->isAvailable())
+        return false;
+
+    CodeGenContext* Ctx = getAnalysis<CodeGenContextWrapper>().getCodeGenContext();
+    // A 32-bit value takes one GRF (32 bytes) for every 8 lanes.
+    Budget = Ctx->getNumGRFPerThread() * 32 / 16;
+
+    RPE->buildRPMapPerInstruction();
+    unsigned NumInsts = RPE->getMaxAssignedNumberForFunction();
+    PeaksBefore.resize(NumInsts + 2);
+    PeaksBefore[0] = 0;
+    for (unsigned N = 0; N <= NumInsts; ++N) {
+        bool IsPeak = RPE->getRegisterPressureForInstructionFromRPMap(N) > Budget;
+        PeaksBefore[N + 1] = PeaksBefore[N] + (IsPeak ? 1 : 0);
+    }
+    // Nothing to split if the kernel already fits at SIMD16.
+    if (PeaksBefore.back() == 0)
+        return false;
+
+    DT = &getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+    LI = &getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+    DL = &F.getParent()->getDataLayout();
+
+    // Collect candidates first as rematerialization changes the IR the
+    // numbering refers to.
+    SmallVector<Instruction*, 64> Candidates;
+    for (auto& BB : F)
+        for (auto& I : BB)
+            if (!isa<PHINode>(I) && !I.use_empty() &&
+                RPE->getLiveRangeOrNull(&I))
+                Candidates.push_back(&I);
+
+    bool Changed = false;
+    for (auto* I : Candidates)
+        Changed |= reMaterialize(I);
+
+    // Values recomputed in every phase using them are dead now. Users come
+    // after their operands in the candidate list.
+    for (auto I = Candidates.rbegin(), E = Candidates.rend(); I != E; ++I)
+        if (isInstructionTriviallyDead(*I))
+            (*I)->eraseFromParent();
+
+    PeaksBefore.clear();
+    RematBlocks.clear();
+    Clones.clear();
+    return Changed;
+}
+
+bool PhaseRemat::isLiveAt(Value* V, unsigned N) const {
+    auto* LR = RPE->getLiveRangeOrNull(V);
+    return LR && LR->contains(N);
+}
+
+/// Check whether a value defined at `From` and used at `To` is kept in
+/// registers across a point where the pressure exceeds the budget, i.e. the
+/// def and the use sit in different phases of the kernel.
+bool PhaseRemat::crossesPeak(unsigned From, unsigned To) const {
+    unsigned Last = std::min<unsigned>(To, PeaksBefore.size() - 1);
+    return From + 1 < Last && PeaksBefore[Last] > PeaksBefore[From + 1];
+}
+
+/// Collect in `Expr`, operands first, the instructions that have to be cloned
+/// to recompute `I` at `InsertPt` (numbered `N`). Leaves must either be
+/// constants or values still live at `N`; arguments are accepted as well but
+/// their size is accounted in `ExtendedBytes` as their live range grows.
+bool PhaseRemat::collectExpr(Instruction* I, Instruction* InsertPt, unsigned N,
+    SmallVectorImpl<Instruction*>& Expr, unsigned& ExtendedBytes) const {
+    if (Expr.size() >= MaxExprSize)
+        return false;
+    if (!isa<BinaryOperator>(I) && !isa<CastInst>(I) && !isa<CmpInst>(I) &&
+        !isa<GetElementPtrInst>(I) && !isa<SelectInst>(I))
+        return false;
+    // Division may trap and is too expensive to be recomputed anyway.
+    if (auto* BO = dyn_cast<BinaryOperator>(I)) {
+        switch (BO->getOpcode()) {
+        default:
+            break;
+        case Instruction::UDiv:
+        case Instruction::SDiv:
+        case Instruction::URem:
+        case Instruction::SRem:
+        case Instruction::FDiv:
+        case Instruction::FRem:
+            return false;
+        }
+    }
+
+    for (Value* Op : I->operands()) {
+        if (isa<Constant>(Op))
+            continue;
+        if (auto* Arg = dyn_cast<Argument>(Op)) {
+            if (!isLiveAt(Arg, N))
+                ExtendedBytes += (unsigned)DL->getTypeAllocSize(Arg->getType());
+            continue;
+        }
+        auto* OpI = dyn_cast<Instruction>(Op);
+        if (!OpI)
+            return false;
+        if (isLiveAt(OpI, N) && DT->dominates(OpI, InsertPt))
+            continue;
+        if (!collectExpr(OpI, InsertPt, N, Expr, ExtendedBytes))
+            return false;
+    }
+    Expr.push_back(I);
+    return true;
+}
+
+bool PhaseRemat::reMaterialize(Instruction* I) {
+    unsigned DefNum = RPE->getAssignedNumberForInst(I);
+    if (!I->getType()->isSized())
+        return false;
+    unsigned Bytes = (unsigned)DL->getTypeAllocSize(I->getType());
+    unsigned DefDepth = LI->getLoopDepth(I->getParent());
+
+    // Group the uses by the block they are recomputed in so that a phase
+    // recomputes a value once.
+    MapVector<BasicBlock*, SmallVector<Use*, 4>> UsesByBlock;
+    for (auto& U : I->uses()) {
+        Instruction* UserI = cast<Instruction>(U.getUser());
+        if (Clones.count(UserI))
+            continue;
+        BasicBlock* BB = UserI->getParent();
+        Instruction* UsePt = UserI;
+        if (PHINode* PN = dyn_cast<PHINode>(UserI)) {
+            BB = PN->getIncomingBlock(U);
+            UsePt = BB->getTerminator();
+        }
+        // Never move the computation into a deeper loop.
+        if (LI->getLoopDepth(BB) > DefDepth || RematBlocks.count(BB))
+            continue;
+        if (!crossesPeak(DefNum, RPE->getAssignedNumberForInst(UsePt)))
+            continue;
+        UsesByBlock[BB].push_back(&U);
+    }
+
+    bool Changed = false;
+    for (auto& Item : UsesByBlock) {
+        BasicBlock* BB = Item.first;
+        // Insert before the first use in the block.
+        Instruction* InsertPt = BB->getTerminator();
+        for (auto& Inst : *BB) {
+            auto IsUser = [&](Use* U) {
+                return U->getUser() == &Inst && !isa<PHINode>(Inst);
+            };
+            if (std::any_of(Item.second.begin(), Item.second.end(), IsUser)) {
+                InsertPt = &Inst;
+                break;
+            }
+        }
+        unsigned N = RPE->getAssignedNumberForInst(InsertPt);
+
+        SmallVector<Instruction*, MaxExprSize> Expr;
+        unsigned ExtendedBytes = 0;
+        if (!collectExpr(I, InsertPt, N, Expr, ExtendedBytes) ||
+            ExtendedBytes >= Bytes)
+            continue;
+
+        ValueToValueMapTy VMap;
+        Instruction* Clone = nullptr;
+        for (auto* E : Expr) {
+            Clone = E->clone();
+            Clone->setName(E->getName() + ".remat");
+            Clone->insertBefore(InsertPt);
+            RemapInstruction(Clone, VMap, RF_NoModuleLevelChanges | RF_IgnoreMissingLocals);
+            VMap[E] = Clone;
+            Clones.insert(Clone);
+        }
+        for (auto* U : Item.second)
+            U->set(Clone);
+        RematBlocks.insert(BB);
+        Changed = true;
+    }
+
+    return Changed;
+}
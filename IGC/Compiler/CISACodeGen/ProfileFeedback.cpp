@@ -0,0 +1,235 @@
+/*===================== begin_copyright_notice ==================================
+
+Copyright (c) 2017 Intel Corporation
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+======================= end_copyright_notice ==================================*/
+
+#include "Compiler/CISACodeGen/ProfileFeedback.hpp"
+#include "Compiler/CodeGenContextWrapper.hpp"
+#include "Compiler/CodeGenPublic.h"
+#include "Compiler/IGCPassSupport.h"
+
+#include "common/LLVMWarningsPush.hpp"
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/MDBuilder.h>
+#include <llvm/IR/Module.h>
+#include "llvmWrapper/IR/InstrTypes.h"
+#include "common/LLVMWarningsPop.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+using namespace llvm;
+using namespace IGC;
+
+namespace {
+
+    class ProfileFeedback : public ModulePass
+    {
+    public:
+        static char ID;
+
+        ProfileFeedback() : ModulePass(ID)
+        {
+            initializeProfileFeedbackPass(*PassRegistry::getPassRegistry());
+        }
+
+        StringRef getPassName() const override
+        {
+            return "ProfileFeedback";
+        }
+
+        void getAnalysisUsage(AnalysisUsage& AU) const override
+        {
+            AU.setPreservesCFG();
+            AU.addRequired<CodeGenContextWrapper>();
+        }
+
+        bool runOnModule(Module& M) override;
+
+    private:
+        /// Block index to execution count, per kernel name.
+        typedef DenseMap<unsigned, uint64_t> BlockCountMap;
+        StringMap<BlockCountMap> m_counts;
+
+        bool readProfile(const std::string& fileName, QWORD programHash);
+        bool annotate(Function& F, const BlockCountMap& counts);
+    };
+
+} // namespace
+
+char ProfileFeedback::ID = 0;
+
+#define PASS_FLAG "igc-profile-feedback"
+#define PASS_DESCRIPTION "Apply basic block counts from a profile"
+#define PASS_CFG_ONLY true
+#define PASS_ANALYSIS false
+IGC_INITIALIZE_PASS_BEGIN(ProfileFeedback, PASS_FLAG, PASS_DESCRIPTION, PASS_CFG_ONLY, PASS_ANALYSIS)
+IGC_INITIALIZE_PASS_DEPENDENCY(CodeGenContextWrapper)
+IGC_INITIALIZE_PASS_END(ProfileFeedback, PASS_FLAG, PASS_DESCRIPTION, PASS_CFG_ONLY, PASS_ANALYSIS)
+
+ModulePass* IGC::createProfileFeedbackPass()
+{
+    return new ProfileFeedback();
+}
+
+bool ProfileFeedback::runOnModule(Module& M)
+{
+    std::string fileName(IGC_GET_REGKEYSTRING(ProfileFeedbackFile));
+    if (fileName.empty())
+    {
+        return false;
+    }
+
+    CodeGenContext* ctx = getAnalysis<CodeGenContextWrapper>().getCodeGenContext();
+    if (!readProfile(fileName, ctx->hash.getAsmHash()))
+    {
+        return false;
+    }
+
+    bool changed = false;
+    for (Function& F : M)
+    {
+        auto it = m_counts.find(F.getName());
+        if (!F.isDeclaration() && it != m_counts.end())
+        {
+            changed |= annotate(F, it->second);
+        }
+    }
+    m_counts.clear();
+    return changed;
+}
+
+bool ProfileFeedback::readProfile(const std::string& fileName, QWORD programHash)
+{
+    std::ifstream file(fileName);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+        std::istringstream fields(line);
+        QWORD hash = 0;
+        std::string kernelName;
+        unsigned blockIndex = 0;
+        uint64_t count = 0;
+        if (!(fields >> std::hex >> hash >> std::dec >> kernelName >> blockIndex >> count))
+        {
+            continue;
+        }
+        if (hash == programHash)
+        {
+            m_counts[kernelName][blockIndex] += count;
+        }
+    }
+    return !m_counts.empty();
+}
+
+bool ProfileFeedback::annotate(Function& F, const BlockCountMap& counts)
+{
+    DenseMap<BasicBlock*, uint64_t> blockCounts;
+    unsigned index = 0;
+    for (BasicBlock& BB : F)
+    {
+        auto it = counts.find(index++);
+        if (it != counts.end())
+        {
+            blockCounts[&BB] = it->second;
+        }
+    }
+
+    MDBuilder mdBuilder(F.getContext());
+    bool changed = false;
+    for (BasicBlock& BB : F)
+    {
+        IGCLLVM::TerminatorInst* term = BB.getTerminator();
+        unsigned numSuccs = term->getNumSuccessors();
+        if (numSuccs < 2 || (!isa<BranchInst>(term) && !isa<SwitchInst>(term)))
+        {
+            continue;
+        }
+
+        // The count of an edge is the count of its target only when this block
+        // is the single predecessor of that target. A single unknown edge may
+        // still be derived from the count of this block.
+        SmallVector<uint64_t, 4> edgeCounts(numSuccs, 0);
+        int unknownEdge = -1;
+        bool valid = true;
+        uint64_t knownSum = 0;
+        for (unsigned i = 0; i < numSuccs && valid; ++i)
+        {
+            BasicBlock* succ = term->getSuccessor(i);
+            auto it = blockCounts.find(succ);
+            if (succ->getSinglePredecessor() == &BB && it != blockCounts.end())
+            {
+                edgeCounts[i] = it->second;
+                knownSum += it->second;
+            }
+            else if (unknownEdge < 0)
+            {
+                unknownEdge = i;
+            }
+            else
+            {
+                valid = false;
+            }
+        }
+        if (valid && unknownEdge >= 0)
+        {
+            auto it = blockCounts.find(&BB);
+            if (it == blockCounts.end())
+            {
+                continue;
+            }
+            edgeCounts[unknownEdge] = it->second > knownSum ? it->second - knownSum : 0;
+        }
+        if (!valid)
+        {
+            continue;
+        }
+
+        // Branch weights are 32-bit, scale the counts down to fit.
+        uint64_t maxCount = *std::max_element(edgeCounts.begin(), edgeCounts.end());
+        uint64_t scale = maxCount / UINT32_MAX + 1;
+        SmallVector<uint32_t, 4> weights;
+        for (uint64_t count : edgeCounts)
+        {
+            // Keep never-taken edges distinguishable from unknown ones.
+            weights.push_back((uint32_t)(count / scale) + 1);
+        }
+        term->setMetadata(LLVMContext::MD_prof, mdBuilder.createBranchWeights(weights));
+        term->setMetadata(ProfileFeedbackMDName, MDNode::get(F.getContext(), None));
+        changed = true;
+    }
+    return changed;
+}
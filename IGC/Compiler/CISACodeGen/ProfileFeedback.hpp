@@ -0,0 +1,57 @@
+/*===================== begin_copyright_notice ==================================
+
+Copyright (c) 2017 Intel Corporation
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+======================= end_copyright_notice ==================================*/
+
+#pragma once
+
+#include "common/LLVMWarningsPush.hpp"
+#include <llvm/Pass.h>
+#include "common/LLVMWarningsPop.hpp"
+
+namespace IGC
+{
+    /// Applies measured basic block counts to the kernels of the program being
+    /// compiled, as branch weights on their conditional branches.
+    ///
+    /// The counts are read from the file named by the ProfileFeedbackFile
+    /// regkey. Each line holds, separated by spaces, the program hash (hex),
+    /// the kernel name, the index of a basic block in the kernel as seen by
+    /// this pass, and the number of times that block was executed. Lines
+    /// starting with '#' are ignored.
+    ///
+    /// This is only the consuming half of PGO. Nothing in IGC emits these
+    /// counts, and the block index is the LLVM IR block order when this pass
+    /// runs, which does not map to GT-Pin or vISA block ids. A profile has to
+    /// come from a tool that numbers the blocks the same way. The only
+    /// consumer of the weights today is Simd32Profitability.
+    ///
+    /// Terminators annotated from the profile are also tagged with an empty
+    /// node under this name, so that consumers can tell measured weights from
+    /// the ones the frontend derived from llvm.expect.
+    const char* const ProfileFeedbackMDName = "igc.profile.feedback";
+
+    llvm::ModulePass* createProfileFeedbackPass();
+    void initializeProfileFeedbackPass(llvm::PassRegistry&);
+} // namespace IGC
@@ -59,6 +59,8 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Compiler/CISACodeGen/MemOpt.h"
 #include "Compiler/CISACodeGen/MemOpt2.h"
 #include "Compiler/CISACodeGen/PreRARematFlag.h"
+#include "Compiler/CISACodeGen/PhaseRemat.h"
+#include "Compiler/CISACodeGen/ProfileFeedback.hpp"
 #include "Compiler/CISACodeGen/PreRAScheduler.hpp"
 #include "Compiler/CISACodeGen/ResolveGAS.h"
 #include "Compiler/CISACodeGen/ResolvePredefinedConstant.h"
@@ -270,6 +272,16 @@ namespace IGC
     // Also need to understand the performance benefit better.
     mpm.add(new CodeSinking(true));
 
+    // A kernel spilling at SIMD16 gets its long live ranges split at the
+    // pressure peaks when recompiled, rather than falling back to SIMD8.
+    if ((ctx.type == ShaderType::OPENCL_SHADER || ctx.type == ShaderType::COMPUTE_SHADER) &&
+        ctx.m_retryManager.AllowPhaseRemat() &&
+        IGC_IS_FLAG_ENABLED(EnablePhaseRemat) &&
+        !isOptDisabled)
+    {
+        mpm.add(createPhaseRematPass());
+    }
+
     if (ctx.type == ShaderType::PIXEL_SHADER)
         mpm.add(new PixelShaderAddMask());
 
@@ -357,6 +369,12 @@ namespace IGC
     initializeSimd32ProfitabilityAnalysisPass(*PassRegistry::getPassRegistry());
     initializeGenXFunctionGroupAnalysisPass(*PassRegistry::getPassRegistry());
 
+    // Apply measured block counts before any code generation decision is made.
+    if (*IGC_GET_REGKEYSTRING(ProfileFeedbackFile) != '\0')
+    {
+        mpm.add(createProfileFeedbackPass());
+    }
+
 
     if (ctx.type == ShaderType::PIXEL_SHADER)
     {
@@ -856,6 +874,27 @@ namespace IGC
         static const int SIMD16_NUM_TEMPREG_THRESHOLD = 92;
         static const int SIMD16_SLM_NUM_TEMPREG_THRESHOLD = 128;
 
+        // SIMD32 is expected to win if it is picked whenever it does not spill
+        // (or has strictly better occupancy) and its register footprint, twice
+        // that of SIMD16, still fits the SIMD16 budget without spills.
+        // Compiling SIMD32 first bypasses the checks CompileSIMDSize makes on
+        // the SIMD16 result, so the ones that do not depend on it are applied
+        // here as well; a spilling SIMD32 is still aborted.
+        auto isSimd32LikelyWinner = [ctx]()
+        {
+            if (ctx->isSecondCompile)
+            {
+                return false;
+            }
+            float occu16 = ctx->GetThreadOccupancy(SIMDMode::SIMD16);
+            float occu32 = ctx->GetThreadOccupancy(SIMDMode::SIMD32);
+            bool compiledAfterSimd16 = occu32 > occu16 ||
+                (occu32 == occu16 && ctx->m_instrTypes.hasBarrier);
+            bool preferred = IGC_IS_FLAG_ENABLED(EnableHighestSIMDForNoSpill) || occu32 > occu16;
+            return compiledAfterSimd16 && preferred &&
+                ctx->m_tempCount * 2 <= SIMD16_NUM_TEMPREG_THRESHOLD;
+        };
+
         switch (simdModeAllowed)
         {
         case SIMDMode::SIMD8:
@@ -903,11 +942,17 @@ namespace IGC
             {
                 bool earlyExit = (!allowSpill || ctx->instrStat[SROA_PROMOTED][EXCEED_THRESHOLD]);
 
+                // Compile SIMD32 first when it is the likely winner, so that
+                // SIMD16 and SIMD8 can be skipped once it turns out spill-free.
+                bool simd32First = cgSimd32 && isSimd32LikelyWinner();
+                if (simd32First)
+                    AddCodeGenPasses(*ctx, shaders, PassMgr, SIMDMode::SIMD32, true);
+
                 // allow simd16 spill if having SLM
                 if (cgSimd16)
                     AddCodeGenPasses(*ctx, shaders, PassMgr, SIMDMode::SIMD16, earlyExit);
 
-                if (cgSimd32)
+                if (cgSimd32 && !simd32First)
                     AddCodeGenPasses(*ctx, shaders, PassMgr, SIMDMode::SIMD32, true);
 
                 AddCodeGenPasses(*ctx, shaders, PassMgr, SIMDMode::SIMD8,
@@ -918,8 +963,14 @@ namespace IGC
 
         case SIMDMode::SIMD16:
         {
+            bool cgSimd32 = !ctx->m_enableSubroutine && maxSimdMode == SIMDMode::SIMD32;
+            bool simd32First = cgSimd32 && isSimd32LikelyWinner();
+            if (simd32First)
+            {
+                AddCodeGenPasses(*ctx, shaders, PassMgr, SIMDMode::SIMD32, true);
+            }
             AddCodeGenPasses(*ctx, shaders, PassMgr, SIMDMode::SIMD16, !ctx->m_retryManager.IsLastTry(ctx));
-            if (!ctx->m_enableSubroutine && maxSimdMode == SIMDMode::SIMD32)
+            if (cgSimd32 && !simd32First)
             {
                 AddCodeGenPasses(*ctx, shaders, PassMgr, SIMDMode::SIMD32, true);
             }
@@ -1529,6 +1580,10 @@ namespace IGC
         {
             if (pContext->m_enableSubroutine)
             {
+                if (IGC_IS_FLAG_ENABLED(EnablePartialInlining))
+                {
+                    mpm.add(createPartialInliningPass());
+                }
                 mpm.add(createEstimateFunctionSizePass(EstimateFunctionSize::AL_Kernel));
                 mpm.add(createSubroutineInlinerPass());
             }
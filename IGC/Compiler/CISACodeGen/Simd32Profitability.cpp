@@ -29,6 +29,7 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Compiler/CodeGenPublic.h"
 #include "Compiler/IGCPassSupport.h"
 #include "Compiler/CISACodeGen/Platform.hpp"
+#include "Compiler/CISACodeGen/ProfileFeedback.hpp"
 
 #include "common/LLVMWarningsPush.hpp"
 #include <llvm/IR/InstIterator.h>
@@ -471,9 +472,42 @@ unsigned Simd32ProfitabilityAnalysis::estimateLoopCount_CASE2(Loop* L) {
     return LOOPCOUNT_UNKNOWN;
 }
 
+/// Use the average trip count measured by a profile, if one was applied to this
+/// kernel (see ProfileFeedback).
+unsigned Simd32ProfitabilityAnalysis::estimateLoopCount_PROFILE(Loop* L) {
+    BasicBlock* Latch = L->getLoopLatch();
+    if (!Latch)
+        return LOOPCOUNT_UNKNOWN;
+
+    BranchInst* Br = dyn_cast<BranchInst>(Latch->getTerminator());
+    if (!Br || !Br->isConditional())
+        return LOOPCOUNT_UNKNOWN;
+
+    // Weights from __builtin_expect are guesses, not trip counts.
+    if (!Br->getMetadata(ProfileFeedbackMDName))
+        return LOOPCOUNT_UNKNOWN;
+
+    uint64_t TrueWeight, FalseWeight;
+    if (!Br->extractProfMetadata(TrueWeight, FalseWeight))
+        return LOOPCOUNT_UNKNOWN;
+
+    bool BackOnTrue = L->contains(Br->getSuccessor(0));
+    uint64_t BackEdge = BackOnTrue ? TrueWeight : FalseWeight;
+    uint64_t Exit = BackOnTrue ? FalseWeight : TrueWeight;
+    if (Exit == 0)
+        return LOOPCOUNT_UNKNOWN;
+
+    // Same bound as for constant trip counts in CASE2.
+    return (BackEdge + Exit) / Exit < 100 ? LOOPCOUNT_LIKELY_SMALL : LOOPCOUNT_LIKELY_LARGE;
+}
+
 unsigned Simd32ProfitabilityAnalysis::estimateLoopCount(Loop* L) {
     unsigned Ret;
 
+    Ret = estimateLoopCount_PROFILE(L);
+    if (Ret != LOOPCOUNT_UNKNOWN)
+        return Ret;
+
     Ret = estimateLoopCount_CASE1(L);
     if (Ret != LOOPCOUNT_UNKNOWN)
         return Ret;
@@ -85,6 +85,7 @@ namespace IGC
         unsigned estimateLoopCount(llvm::Loop* L);
         unsigned estimateLoopCount_CASE1(llvm::Loop* L);
         unsigned estimateLoopCount_CASE2(llvm::Loop* L);
+        unsigned estimateLoopCount_PROFILE(llvm::Loop* L);
 
         bool isSelectBasedOnGlobalIdX(llvm::Value*);
 
@@ -41,12 +41,13 @@ namespace IGC
         bool allowPromotePrivateMemory;
         bool allowPreRAScheduler;
         bool allowLargeURBWrite;
+        bool allowPhaseRemat;
         unsigned nextState;
     } RetryState;
 
     static const RetryState RetryTable[] = {
-        { true, true, false, true, true, true, 1 },
-        { false, true, true, false, false, false, 500 }
+        { true, true, false, true, true, true, false, 1 },
+        { false, true, true, false, false, false, true, 500 }
     };
 
     RetryManager::RetryManager() : enabled(false)
@@ -90,6 +91,10 @@ namespace IGC
         assert(stateId < getStateCnt());
         return RetryTable[stateId].allowLargeURBWrite;
     }
+    bool RetryManager::AllowPhaseRemat() {
+        assert(stateId < getStateCnt());
+        return RetryTable[stateId].allowPhaseRemat;
+    }
     bool RetryManager::IsFirstTry() {
         return (stateId == firstStateId);
     }
@@ -625,6 +625,7 @@ namespace IGC
         bool AllowCodeSinking();
         bool AllowSimd32Slicing();
         bool AllowLargeURBWrite();
+        bool AllowPhaseRemat();
         bool IsFirstTry();
         bool IsLastTry(CodeGenContext* cgCtx);
         unsigned GetRetryId() const;
@@ -58,6 +58,7 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "llvm/MC/MachineLocation.h"
 #include "llvm/IR/GlobalValue.h"
 #include "llvm/IR/IntrinsicInst.h"
+#include "llvm/Support/MD5.h"
 #include "common/LLVMWarningsPop.hpp"
 
 #include "Compiler/CISACodeGen/helper.h"
@@ -653,9 +654,31 @@ DIE* CompileUnit::getOrCreateTypeDIE(const MDNode* TyNode)
     if (TyDIE)
         return TyDIE;
 
+    // Distinct composite nodes with identical content (the same struct
+    // pulled in by several linked modules) share one DIE.
+    uint64_t Signature = 0;
+    if (auto * CTy = dyn_cast<DICompositeType>(Ty))
+    {
+        Signature = getTypeSignature(CTy);
+        if (Signature != 0)
+        {
+            TyDIE = DD->getTypeSignatureDIE(Signature);
+            if (TyDIE && TyDIE->getParent() == ContextDIE)
+            {
+                insertDIE(Ty, TyDIE);
+                return TyDIE;
+            }
+        }
+    }
+
     // Create new type.
     TyDIE = createAndAddDIE(Ty->getTag(), *ContextDIE, Ty);
 
+    if (Signature != 0 && !DD->getTypeSignatureDIE(Signature))
+    {
+        DD->insertTypeSignatureDIE(Signature, TyDIE);
+    }
+
     if (isa<DIBasicType>(Ty))
         constructTypeDIE(*TyDIE, cast<DIBasicType>(Ty));
     else if (isa<DICompositeType>(Ty))
@@ -671,6 +694,148 @@ DIE* CompileUnit::getOrCreateTypeDIE(const MDNode* TyNode)
     return TyDIE;
 }
 
+static void addIntToSignature(MD5& Hash, uint64_t V)
+{
+    Hash.update(StringRef(reinterpret_cast<const char*>(&V), sizeof(V)));
+}
+
+static void addStrToSignature(MD5& Hash, StringRef S)
+{
+    addIntToSignature(Hash, S.size());
+    Hash.update(S);
+}
+
+/// getTypeSignature - Hash the parts of a composite type that end up in its
+/// DIE, including the types it refers to, see addTypeToSignature.
+uint64_t CompileUnit::getTypeSignature(DICompositeType* CTy) const
+{
+    switch (CTy->getTag())
+    {
+    case dwarf::DW_TAG_structure_type:
+    case dwarf::DW_TAG_union_type:
+    case dwarf::DW_TAG_class_type:
+    case dwarf::DW_TAG_enumeration_type:
+        break;
+    default:
+        return 0;
+    }
+
+    // Anonymous or forward declared types are not worth the risk of
+    // merging unrelated entities.
+    if (CTy->getName().empty() || CTy->isForwardDecl())
+        return 0;
+
+    for (auto* Element : CTy->getElements())
+    {
+        // Static members are looked up by node later on, so their owner
+        // needs a DIE of its own. The same goes for member functions,
+        // template parameters etc.
+        auto* DT = dyn_cast<DIDerivedType>(Element);
+        if (DT ? DT->isStaticMember() : !isa<DIEnumerator>(Element))
+            return 0;
+    }
+
+    MD5 Hash;
+    llvm::DenseMap<const DIType*, unsigned> Visited;
+    addTypeToSignature(Hash, CTy, Visited);
+
+    MD5::MD5Result Result;
+    Hash.final(Result);
+
+    uint64_t Signature = 0;
+    for (unsigned i = 0; i < 8; i++)
+    {
+        Signature |= (uint64_t)Result[i] << (8 * i);
+    }
+
+    // Keep clear of the reserved DenseMap keys.
+    if (Signature >= ~0ULL - 1)
+        Signature = 0;
+    return Signature;
+}
+
+/// addTypeToSignature - Hash a type and, recursively, the types it refers
+/// to. A type seen before is hashed by the order it was first visited in, so
+/// self-referencing types terminate and still hash by their shape.
+void CompileUnit::addTypeToSignature(MD5& Hash, DIType* Ty,
+    llvm::DenseMap<const DIType*, unsigned>& Visited) const
+{
+    if (!Ty)
+    {
+        addIntToSignature(Hash, 'N');
+        return;
+    }
+
+    auto It = Visited.find(Ty);
+    if (It != Visited.end())
+    {
+        addIntToSignature(Hash, 'R');
+        addIntToSignature(Hash, It->second);
+        return;
+    }
+    unsigned Index = Visited.size();
+    Visited[Ty] = Index;
+
+    addIntToSignature(Hash, 'T');
+    addIntToSignature(Hash, Ty->getTag());
+    addStrToSignature(Hash, Ty->getName());
+    addIntToSignature(Hash, Ty->getSizeInBits());
+
+    if (auto * BTy = dyn_cast<DIBasicType>(Ty))
+    {
+        addIntToSignature(Hash, BTy->getEncoding());
+    }
+    else if (auto * DT = dyn_cast<DIDerivedType>(Ty))
+    {
+        addIntToSignature(Hash, DT->getOffsetInBits());
+        addTypeToSignature(Hash, resolve(DT->getBaseType()), Visited);
+    }
+    else if (auto * STy = dyn_cast<DISubroutineType>(Ty))
+    {
+        for (auto Element : STy->getTypeArray())
+            addTypeToSignature(Hash, resolve(Element), Visited);
+    }
+    else if (auto * CTy = dyn_cast<DICompositeType>(Ty))
+    {
+        addIntToSignature(Hash, CTy->getLine());
+        addStrToSignature(Hash, CTy->getFilename());
+        addStrToSignature(Hash, CTy->getDirectory());
+        if (DIScope * Scope = resolve(CTy->getScope()))
+            addStrToSignature(Hash, Scope->getName());
+        addTypeToSignature(Hash, resolve(CTy->getBaseType()), Visited);
+
+        for (auto* Element : CTy->getElements())
+        {
+            if (auto * Enum = dyn_cast<DIEnumerator>(Element))
+            {
+                addStrToSignature(Hash, Enum->getName());
+                addIntToSignature(Hash, (uint64_t)Enum->getValue());
+            }
+            else if (auto * SR = dyn_cast<DISubrange>(Element))
+            {
+                addIntToSignature(Hash, SR->getTag());
+                addIntToSignature(Hash, (uint64_t)SR->getLowerBound());
+#if LLVM_VERSION_MAJOR >= 7
+                if (auto * Count = SR->getCount().dyn_cast<ConstantInt*>())
+                    addIntToSignature(Hash, Count->getSExtValue());
+#else
+                addIntToSignature(Hash, SR->getCount());
+#endif
+            }
+            else if (auto * ElementTy = dyn_cast<DIType>(Element))
+            {
+                addTypeToSignature(Hash, ElementTy, Visited);
+            }
+            else
+            {
+                addIntToSignature(Hash, Element->getTag());
+                if (auto * SP = dyn_cast<DISubprogram>(Element))
+                    addStrToSignature(Hash, SP->getName());
+            }
+        }
+    }
+}
+
 /// addType - Add a new type attribute to the specified entity.
 void CompileUnit::addType(DIE* Entity, DIType* Ty, dwarf::Attribute Attribute)
 {
@@ -57,6 +57,7 @@ namespace llvm
     class ConstantInt;
     class ConstantFP;
     class MCExpr;
+    class MD5;
 }
 
 namespace IGC
@@ -324,6 +325,17 @@ namespace IGC
         /// getOrCreateStaticMemberDIE - Create new static data member DIE.
         DIE* getOrCreateStaticMemberDIE(llvm::DIDerivedType* DT);
 
+        /// getTypeSignature - Compute a content hash for a composite type, in
+        /// the spirit of DWARF type unit signatures. Returns 0 when the type
+        /// cannot safely share its DIE with another node.
+        uint64_t getTypeSignature(llvm::DICompositeType* CTy) const;
+
+        /// addTypeToSignature - Add a type and the types it refers to to the
+        /// hash of a type signature. Visited maps the types hashed so far to
+        /// the order they were hashed in.
+        void addTypeToSignature(llvm::MD5& Hash, llvm::DIType* Ty,
+            llvm::DenseMap<const llvm::DIType*, unsigned>& Visited) const;
+
         /// Offset of the CUDie from beginning of debug info section.
         unsigned DebugInfoOffset;
 
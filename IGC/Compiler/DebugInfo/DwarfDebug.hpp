@@ -270,6 +270,11 @@ namespace IGC
         /// of in CompileUnit.
         llvm::DenseMap<const llvm::MDNode*, DIE*> MDTypeNodeToDieMap;
 
+        /// Maps composite type signatures to the DIE built for the first type
+        /// with that content. Distinct type nodes coming from different linked
+        /// modules (e.g. the user program and builtins) share a single DIE.
+        llvm::DenseMap<uint64_t, DIE*> TypeSignatureToDieMap;
+
         // Used to uniquely define abbreviations.
         llvm::FoldingSet<DIEAbbrev> AbbreviationsSet;
 
@@ -542,6 +547,14 @@ namespace IGC
         {
             return MDTypeNodeToDieMap.lookup(TypeMD);
         }
+        void insertTypeSignatureDIE(uint64_t Signature, DIE* Die)
+        {
+            TypeSignatureToDieMap.insert(std::make_pair(Signature, Die));
+        }
+        DIE* getTypeSignatureDIE(uint64_t Signature)
+        {
+            return TypeSignatureToDieMap.lookup(Signature);
+        }
 
         /// \brief Emit all Dwarf sections that should come prior to the
         /// content.
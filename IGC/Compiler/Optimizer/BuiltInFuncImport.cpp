@@ -36,6 +36,7 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <llvm/IR/Instruction.h>
 #include <llvm/IR/InstIterator.h>
 #include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/ADT/StringSet.h>
 #include <llvm/Linker/Linker.h>
 #include <llvm/Transforms/Utils/ValueMapper.h>
 #include <llvm/Transforms/Utils/Cloning.h>
@@ -484,48 +485,143 @@ std::unique_ptr<llvm::Module> BIImport::Construct(Module& M, CLElfLib::CElfReade
     return BIM;
 }
 
-bool BIImport::runOnModule(Module& M)
+static void SetKMPLockAttributes(Function* pFunc)
 {
-    if (m_GenericModule == nullptr)
+    if (pFunc->getName().startswith("__builtin_IB_kmp_"))
+    {
+        pFunc->addFnAttr(llvm::Attribute::NoInline);
+        pFunc->addFnAttr("KMPLOCK");
+    }
+}
+
+bool BIImport::ReadCallGraph(Module* pModule, TCallGraph& callGraph)
+{
+    if (Error err = pModule->materializeMetadata())
+    {
+        consumeError(std::move(err));
+        return false;
+    }
+
+    NamedMDNode* pCallGraphMD = pModule->getNamedMetadata("igc.bif.callgraph");
+    if (!pCallGraphMD)
     {
         return false;
     }
 
+    // Each line is "<caller> <callee> <callee> ...". The strings are owned by the
+    // context, so the references stay valid after the module is linked away.
+    for (MDNode* pNode : pCallGraphMD->operands())
+    {
+        if (pNode->getNumOperands() == 0)
+            continue;
+        MDString* pGraph = dyn_cast<MDString>(pNode->getOperand(0));
+        if (!pGraph)
+            continue;
+
+        StringRef rest = pGraph->getString();
+        while (!rest.empty())
+        {
+            StringRef line;
+            std::tie(line, rest) = rest.split('\n');
+            StringRef caller, callees;
+            std::tie(caller, callees) = line.split(' ');
+            if (!caller.empty())
+            {
+                callGraph[caller] = callees;
+            }
+        }
+    }
+
+    // Do not let the linker carry the graph into the kernel module.
+    pCallGraphMD->eraseFromParent();
+    return true;
+}
+
+void BIImport::ImportUsingCallGraph(Module& M, const TCallGraph& callGraph)
+{
+    // Walk the graph from every builtin the kernels reference. Only names are
+    // visited here, nothing in the builtin modules is materialized.
+    StringSet<> needed;
+    SmallVector<StringRef, 64> worklist;
+    auto Visit = [&](StringRef funcName)
+    {
+        auto it = callGraph.find(funcName);
+        if (it != callGraph.end() && needed.insert(it->getKey()).second)
+        {
+            worklist.push_back(it->getKey());
+        }
+    };
 
     for (auto& F : M)
     {
         if (F.isDeclaration())
         {
-            auto FuncName = F.getName();
-            std::string NewFuncName = "";
+            Visit(F.getName());
+        }
+    }
 
-            std::string ReplaceStr = FuncName.slice(2, FuncName.size()).str();
-            if (MangleStr.find(ReplaceStr) != MangleStr.end())
-            {
-                NewFuncName = "_Z" + MangleStr[ReplaceStr];
-            }
-            else if (isMangledImageFn(FuncName, MangleSubst))
-            {
-                NewFuncName = updateSPIRmangleName(FuncName, MangleSubst);
-            }
-            else
-            {
-                NewFuncName = FuncName;
-            }
-            // Current workaround to support binaries compiled with < 3.8 clang
-            // This is for dealing with constant (K) and volatile (V) types
-            if (NewFuncName.find("V") != std::string::npos)
-            {
-                NewFuncName = updateSPIRmangleName38_to_40(NewFuncName, 'V');
-            }
-            else if (NewFuncName.find("K") != std::string::npos)
+    while (!worklist.empty())
+    {
+        StringRef callees = callGraph.lookup(worklist.pop_back_val());
+        while (!callees.empty())
+        {
+            StringRef callee;
+            std::tie(callee, callees) = callees.split(' ');
+            Visit(callee);
+        }
+    }
+
+    // Tag the closure and declare it in M. Declarations are what LinkOnlyNeeded
+    // resolves, so this also covers size_t builtins calling generic ones, whose
+    // module is linked first. Bodies are read only when the linker moves them.
+    for (auto& entry : needed)
+    {
+        Function* pFunc = GetBuiltinFunction2(entry.getKey());
+        if (!pFunc)
+            continue;
+
+        pFunc->addAttribute(IGCLLVM::AttributeSet::FunctionIndex, llvm::Attribute::Builtin);
+        SetKMPLockAttributes(pFunc);
+
+        if (!pFunc->hasLocalLinkage() && !M.getNamedValue(pFunc->getName()))
+        {
+            Function::Create(pFunc->getFunctionType(), GlobalValue::ExternalLinkage, pFunc->getName(), &M);
+        }
+    }
+
+    // Builtin globals (e.g. the flags set by InitializeBIFlags) are always imported.
+    auto DeclareGlobals = [&M](Module* pModule)
+    {
+        for (auto& GV : pModule->globals())
+        {
+            if (!GV.hasLocalLinkage() && !GV.hasAppendingLinkage() && !M.getNamedValue(GV.getName()))
             {
-                NewFuncName = updateSPIRmangleName38_to_40(NewFuncName, 'K');
+                new GlobalVariable(M, GV.getValueType(), GV.isConstant(), GlobalValue::ExternalLinkage,
+                    nullptr, GV.getName(), nullptr, GV.getThreadLocalMode(), GV.getType()->getAddressSpace());
             }
-            F.setName(NewFuncName);
         }
+    };
+
+    DeclareGlobals(m_GenericModule.get());
+    if (m_SizeModule)
+    {
+        DeclareGlobals(m_SizeModule.get());
+    }
+
+    Linker ld(M);
+    if (ld.linkInModule(std::move(m_GenericModule), Linker::LinkOnlyNeeded))
+    {
+        assert(0 && "Error linking generic builtin module");
     }
 
+    if (m_SizeModule && ld.linkInModule(std::move(m_SizeModule), Linker::LinkOnlyNeeded))
+    {
+        assert(0 && "Error linking size_t builtin module");
+    }
+}
+
+void BIImport::ImportByMaterializing(Module& M)
+{
     std::function<void(Function*)> Explore = [&](Function* pRoot) -> void
     {
         TFunctionsVec calledFuncs;
@@ -561,11 +657,7 @@ bool BIImport::runOnModule(Module& M)
                 }
             }
 
-            if (pFunc->getName().startswith("__builtin_IB_kmp_"))
-            {
-                pFunc->addFnAttr(llvm::Attribute::NoInline);
-                pFunc->addFnAttr("KMPLOCK");
-            }
+            SetKMPLockAttributes(pFunc);
         }
     };
 
@@ -615,6 +707,66 @@ bool BIImport::runOnModule(Module& M)
             assert(0 && "Error linking size_t builtin module");
         }
     }
+}
+
+bool BIImport::runOnModule(Module& M)
+{
+    if (m_GenericModule == nullptr)
+    {
+        return false;
+    }
+
+
+    for (auto& F : M)
+    {
+        if (F.isDeclaration())
+        {
+            auto FuncName = F.getName();
+            std::string NewFuncName = "";
+
+            std::string ReplaceStr = FuncName.slice(2, FuncName.size()).str();
+            if (MangleStr.find(ReplaceStr) != MangleStr.end())
+            {
+                NewFuncName = "_Z" + MangleStr[ReplaceStr];
+            }
+            else if (isMangledImageFn(FuncName, MangleSubst))
+            {
+                NewFuncName = updateSPIRmangleName(FuncName, MangleSubst);
+            }
+            else
+            {
+                NewFuncName = FuncName;
+            }
+            // Current workaround to support binaries compiled with < 3.8 clang
+            // This is for dealing with constant (K) and volatile (V) types
+            if (NewFuncName.find("V") != std::string::npos)
+            {
+                NewFuncName = updateSPIRmangleName38_to_40(NewFuncName, 'V');
+            }
+            else if (NewFuncName.find("K") != std::string::npos)
+            {
+                NewFuncName = updateSPIRmangleName38_to_40(NewFuncName, 'K');
+            }
+            F.setName(NewFuncName);
+        }
+    }
+
+    TCallGraph callGraph;
+    bool hasCallGraph = ReadCallGraph(m_GenericModule.get(), callGraph);
+    if (m_SizeModule)
+    {
+        // Both modules have to carry a graph, otherwise the closure is incomplete.
+        hasCallGraph &= ReadCallGraph(m_SizeModule.get(), callGraph);
+    }
+
+    if (hasCallGraph)
+    {
+        ImportUsingCallGraph(M, callGraph);
+    }
+    else
+    {
+        ImportByMaterializing(M);
+    }
 
     InitializeBIFlags(M);
     removeFunctionBitcasts(M);
@@ -30,6 +30,7 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "common/LLVMWarningsPush.hpp"
 #include <llvm/Pass.h>
+#include <llvm/ADT/StringMap.h>
 #include "common/LLVMWarningsPop.hpp"
 
 #include "AdaptorOCL/CLElfLib/ElfReader.h"
@@ -46,6 +47,9 @@ namespace IGC
     protected:
         // Type used to hold a vector of Functions and augment it during traversal.
         typedef std::vector<llvm::Function*>       TFunctionsVec;
+        // Type used to hold the call graph recorded at BiF build time.
+        // Maps the name of each defined builtin to the space separated names of its callees.
+        typedef llvm::StringMap<llvm::StringRef>   TCallGraph;
 
     public:
         // Pass identification, replacement for typeid.
@@ -81,6 +85,24 @@ namespace IGC
         /// @param [OUT] calledFuncs The list of all functions called by pFunc.
         static void GetCalledFunctions(const llvm::Function* pFunc, TFunctionsVec& calledFuncs);
 
+        /// @brief  Read the call graph embedded in a builtin module by the BiF build
+        ///         (!igc.bif.callgraph) and drop it from the module.
+        /// @param [IN] pModule The builtin module.
+        /// @param [OUT] callGraph The call graph to extend.
+        /// @returns false if the module carries no call graph.
+        static bool ReadCallGraph(llvm::Module* pModule, TCallGraph& callGraph);
+
+        /// @brief  Import the closure of builtins reachable from the declarations in M,
+        ///         as given by the precomputed call graph.
+        /// @param [IN] M The destination module.
+        /// @param [IN] callGraph The call graph of the builtin modules.
+        void ImportUsingCallGraph(llvm::Module& M, const TCallGraph& callGraph);
+
+        /// @brief  Import builtins by discovering callees through materialization.
+        ///         Used when the builtin modules carry no call graph.
+        /// @param [IN] M The destination module.
+        void ImportByMaterializing(llvm::Module& M);
+
         /// @brief  Remove function bitcasts that sometimes may appear due to the changed in the way
         ///         the BiFs are linked. We can remove this code once llvm implements typeless pointers.
         void removeFunctionBitcasts(llvm::Module& M);
@@ -35,6 +35,7 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <llvm/Transforms/Utils/BasicBlockUtils.h>
 #include "common/LLVMWarningsPop.hpp"
 
+#include <algorithm>
 #include <map>
 
 using namespace llvm;
@@ -180,22 +181,39 @@ namespace IGC
             return false;
         }
 
-        // Add some checks to determine if inlining is profitable
-
-        // Limit the number of branches
-        if (CallableFuncs.size() > 4)
-            return false;
-
-        // Limit max number of instructions added after inlining all functions
+        // Add some checks to determine if inlining is profitable. Rather than
+        // giving up on the whole call, guard the cheapest targets with direct
+        // calls and keep the indirect call as the fallback for the others.
+        std::stable_sort(CallableFuncs.begin(), CallableFuncs.end(),
+            [](Function* F0, Function* F1) {
+                return F0->getInstructionCount() < F1->getInstructionCount();
+            });
+
+        // Limit the number of branches and the max number of instructions
+        // added after inlining the guarded functions
+        const unsigned maxGuardedFuncs = 4;
         unsigned maxInlinedInsts = 0;
+        unsigned numGuardedFuncs = 0;
         for (auto pFunc : CallableFuncs)
         {
             maxInlinedInsts += pFunc->getInstructionCount();
             // Use the OCLInlineThreshold for now
-            if (maxInlinedInsts > IGC_GET_FLAG_VALUE(OCLInlineThreshold))
+            if (numGuardedFuncs == maxGuardedFuncs ||
+                maxInlinedInsts > IGC_GET_FLAG_VALUE(OCLInlineThreshold))
             {
-                return false;
+                break;
             }
+            numGuardedFuncs++;
+        }
+
+        if (numGuardedFuncs == 0)
+        {
+            return false;
+        }
+        if (numGuardedFuncs < CallableFuncs.size())
+        {
+            CallableFuncs.resize(numGuardedFuncs);
+            needFallbackToIndirect = true;
         }
 
         SmallVector<Instruction*, 8> expandedCalls;
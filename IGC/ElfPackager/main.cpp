@@ -91,7 +91,7 @@ void MakeHeader(StringRef Func, SmallVector<char, 0> &headerVector, int index)
     headerVector.push_back((char)(index >> 8));
 }
 
-void CreateElfSection(CLElfLib::CElfWriter* pWriter, CLElfLib::SSectionNode sectionNode, std::string Name, char* pData, unsigned DataSize)
+void CreateElfSection(CLElfLib::CElfWriter* pWriter, CLElfLib::SSectionNode sectionNode, std::string Name, char* pData, unsigned DataSize, bool copyData = true)
 {
     // Create section
     sectionNode.Name = Name;
@@ -100,8 +100,15 @@ void CreateElfSection(CLElfLib::CElfWriter* pWriter, CLElfLib::SSectionNode sect
     sectionNode.Flags = 0;
     sectionNode.Type = SH_TYPE_PROG_BITS;
 
-    // Add it to the file
-    pWriter->AddSection(&sectionNode);
+    // Add it to the file. Without a copy the data must outlive ResolveBinary.
+    if (copyData)
+    {
+        pWriter->AddSection(&sectionNode);
+    }
+    else
+    {
+        pWriter->AddSectionRef(&sectionNode);
+    }
 }
 
 
@@ -472,21 +479,21 @@ int main(int argc, char *argv[])
             OS_sizet64.str().size());
     }
 
-    //Now to add all of the sections in the file
-    for (auto elf_iterator : ElfMap)
+    //Now to add all of the sections in the file. ElfMap outlives the writer,
+    //so the bitcode is referenced rather than copied.
+    for (auto &elf_iterator : ElfMap)
     {
         CreateElfSection(pWriter,
             sectionNode,
             elf_iterator.first,
             const_cast<char*>(elf_iterator.second.data()),
-            elf_iterator.second.size());
+            elf_iterator.second.size(),
+            false);
     }
 
     // Resolve size of ELF blob
-    size_t dataSize = 0;
-    char* ElfBlob = NULL;
-    pWriter->ResolveBinary(ElfBlob, dataSize);
-    ElfBlob = new char[dataSize];
+    size_t dataSize = pWriter->GetBinarySize();
+    char* ElfBlob = new char[dataSize];
     if (ElfBlob == NULL)
     {
         return -1;
@@ -139,7 +139,7 @@ void DumpLLVMIR(IGC::CodeGenContext* pContext, const char* dumpName)
     if (IGC_IS_FLAG_ENABLED(DumpLLVMIR))
     {
         pContext->getMetaDataUtils()->save(*pContext->getLLVMContext());
-        serialize(*(pContext->getModuleMetaData()), pContext->getModule());
+        serializeAsNodeTree(*(pContext->getModuleMetaData()), pContext->getModule());
         using namespace IGC::Debug;
         auto name =
             DumpName(IGC::Debug::GetShaderOutputName())
@@ -6,13 +6,146 @@
 #include <llvm/ADT/StringRef.h>
 #include <llvm/Support/Casting.h>
 #include <llvm/ADT/StringSwitch.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/Support/ErrorHandling.h>
 #include "common/LLVMWarningsPop.hpp"
 
 #include <iostream>
 #include <assert.h>
+#include <cstring>
 
 using namespace llvm;
 
+// Compact encoding of ModuleMetaData: one flat little blob stored as an
+// MDString, plus a tuple holding the llvm::Values the blob refers to by index.
+//
+//   u32 magic, u32 layout hash
+//   ModuleMetaData members in declaration order, where FuncMD is
+//     u32 count, count x { u32 function, FunctionMetaData }
+static const char* const MDBinaryNodeName = "IGCMetadataBin";
+static const uint32_t MDBinaryMagic = 0x4D434749; // "IGCM"
+
+class MDBinaryWriter
+{
+public:
+    explicit MDBinaryWriter(Module* module) : m_module(module) {}
+
+    void write(const void* data, size_t size)
+    {
+        m_buffer.append(static_cast<const char*>(data), size);
+    }
+
+    template<typename T>
+    void writePOD(T val)
+    {
+        write(&val, sizeof(val));
+    }
+
+    // 0 is reserved for null so the index of a value is its slot + 1.
+    uint32_t getValueIndex(Value* val)
+    {
+        if (val == nullptr)
+        {
+            return 0;
+        }
+        auto it = m_valueIndex.find(val);
+        if (it != m_valueIndex.end())
+        {
+            return it->second;
+        }
+        m_values.push_back(ValueAsMetadata::get(val));
+        uint32_t index = (uint32_t)m_values.size();
+        m_valueIndex[val] = index;
+        return index;
+    }
+
+    MDNode* createNode() const
+    {
+        LLVMContext& context = m_module->getContext();
+        Metadata* v[] =
+        {
+            MDString::get(context, m_buffer),
+            MDNode::get(context, m_values),
+        };
+        return MDNode::get(context, v);
+    }
+
+private:
+    Module* m_module;
+    std::string m_buffer;
+    std::vector<Metadata*> m_values;
+    DenseMap<Value*, uint32_t> m_valueIndex;
+};
+
+class MDBinaryReader
+{
+public:
+    MDBinaryReader(StringRef data, const MDNode* values) :
+        m_data(data), m_values(values), m_pos(0), m_failed(false) {}
+
+    // Reads past the end of the blob yield zeros and mark the reader failed.
+    void read(void* data, size_t size)
+    {
+        if (!canRead(size))
+        {
+            memset(data, 0, size);
+            return;
+        }
+        memcpy(data, m_data.data() + m_pos, size);
+        m_pos += size;
+    }
+
+    template<typename T>
+    T readPOD()
+    {
+        T val;
+        read(&val, sizeof(val));
+        return val;
+    }
+
+    StringRef readBytes(size_t size)
+    {
+        if (!canRead(size))
+        {
+            return StringRef();
+        }
+        StringRef bytes = m_data.substr(m_pos, size);
+        m_pos += size;
+        return bytes;
+    }
+
+    // Guards element counts read from the blob: every element takes at least
+    // one byte, so a count larger than what is left means the blob is bad.
+    bool canRead(size_t size)
+    {
+        if (m_failed || size > m_data.size() - m_pos)
+        {
+            m_failed = true;
+            return false;
+        }
+        return true;
+    }
+
+    bool failed() const { return m_failed; }
+
+    // Values deleted after serialization show up as null operands.
+    Value* getValue(uint32_t index) const
+    {
+        if (index == 0 || index > m_values->getNumOperands())
+        {
+            return nullptr;
+        }
+        auto* pVal = dyn_cast_or_null<ValueAsMetadata>(m_values->getOperand(index - 1).get());
+        return pVal ? pVal->getValue() : nullptr;
+    }
+
+private:
+    StringRef m_data;
+    const MDNode* m_values;
+    size_t m_pos;
+    bool m_failed;
+};
+
 //(non-autogen)function prototypes
 MDNode* CreateNode(unsigned char i, Module* module, StringRef name);
 MDNode* CreateNode(int i, Module* module, StringRef name);
@@ -52,6 +185,43 @@ void readNode(std::map<Key, Value> &funcMD, MDNode* node);
 template<typename T>
 void readNode(T &t, MDNode* node, StringRef name);
 
+void writeBinary(bool b, MDBinaryWriter& w);
+void writeBinary(char c, MDBinaryWriter& w);
+void writeBinary(unsigned char c, MDBinaryWriter& w);
+void writeBinary(int i, MDBinaryWriter& w);
+void writeBinary(unsigned i, MDBinaryWriter& w);
+void writeBinary(uint64_t i, MDBinaryWriter& w);
+void writeBinary(float f, MDBinaryWriter& w);
+void writeBinary(const std::string &s, MDBinaryWriter& w);
+void writeBinary(Value* val, MDBinaryWriter& w);
+void writeBinary(Function* funcPtr, MDBinaryWriter& w);
+void writeBinary(GlobalVariable* globalVar, MDBinaryWriter& w);
+template<typename T>
+void writeBinary(const std::vector<T> &vec, MDBinaryWriter& w);
+template<typename T, size_t s>
+void writeBinary(const std::array<T, s> &arr, MDBinaryWriter& w);
+template<typename Key, typename Value>
+void writeBinary(const std::map<Key, Value> &keyMD, MDBinaryWriter& w);
+
+void readBinary(bool &b, MDBinaryReader& r);
+void readBinary(char &c, MDBinaryReader& r);
+void readBinary(unsigned char &c, MDBinaryReader& r);
+void readBinary(int &i, MDBinaryReader& r);
+void readBinary(unsigned &i, MDBinaryReader& r);
+void readBinary(uint64_t &i, MDBinaryReader& r);
+void readBinary(float &f, MDBinaryReader& r);
+void readBinary(std::string &s, MDBinaryReader& r);
+void readBinary(Value* &val, MDBinaryReader& r);
+void readBinary(Function* &funcPtr, MDBinaryReader& r);
+void readBinary(GlobalVariable* &globalVar, MDBinaryReader& r);
+template<typename T>
+void readBinary(std::vector<T> &vec, MDBinaryReader& r);
+template<typename T, size_t s>
+void readBinary(std::array<T, s> &arr, MDBinaryReader& r);
+template<typename Key, typename Value>
+void readBinary(std::map<Key, Value> &keyMD, MDBinaryReader& r);
+void readBinary(std::map<Function*, IGC::FunctionMetaData> &FuncMD, MDBinaryReader& r);
+
 //including auto-generated functions
 #include "MDNodeFunctions.gen"
 namespace IGC
@@ -327,10 +497,236 @@ void readNode(T &t, MDNode* node, StringRef name)
     }
 }
 
+void writeBinary(bool b, MDBinaryWriter& w)
+{
+    w.writePOD<uint8_t>(b ? 1 : 0);
+}
+
+void writeBinary(char c, MDBinaryWriter& w)
+{
+    w.writePOD(c);
+}
+
+void writeBinary(unsigned char c, MDBinaryWriter& w)
+{
+    w.writePOD(c);
+}
+
+void writeBinary(int i, MDBinaryWriter& w)
+{
+    w.writePOD(i);
+}
+
+void writeBinary(unsigned i, MDBinaryWriter& w)
+{
+    w.writePOD(i);
+}
+
+void writeBinary(uint64_t i, MDBinaryWriter& w)
+{
+    w.writePOD(i);
+}
+
+void writeBinary(float f, MDBinaryWriter& w)
+{
+    w.writePOD(f);
+}
+
+void writeBinary(const std::string &s, MDBinaryWriter& w)
+{
+    w.writePOD((uint32_t)s.size());
+    w.write(s.data(), s.size());
+}
+
+void writeBinary(Value* val, MDBinaryWriter& w)
+{
+    w.writePOD(w.getValueIndex(val));
+}
+
+void writeBinary(Function* funcPtr, MDBinaryWriter& w)
+{
+    w.writePOD(w.getValueIndex(funcPtr));
+}
+
+void writeBinary(GlobalVariable* globalVar, MDBinaryWriter& w)
+{
+    w.writePOD(w.getValueIndex(globalVar));
+}
+
+template<typename T>
+void writeBinary(const std::vector<T> &vec, MDBinaryWriter& w)
+{
+    w.writePOD((uint32_t)vec.size());
+    for (auto it = vec.begin(); it != vec.end(); ++it)
+    {
+        writeBinary(*it, w);
+    }
+}
+
+template<typename T, size_t s>
+void writeBinary(const std::array<T, s> &arr, MDBinaryWriter& w)
+{
+    for (unsigned int i = 0; i < s; i++)
+    {
+        writeBinary(arr[i], w);
+    }
+}
+
+template<typename Key, typename Value>
+void writeBinary(const std::map<Key, Value> &keyMD, MDBinaryWriter& w)
+{
+    w.writePOD((uint32_t)keyMD.size());
+    for (auto it = keyMD.begin(); it != keyMD.end(); ++it)
+    {
+        writeBinary(it->first, w);
+        writeBinary(it->second, w);
+    }
+}
+
+void readBinary(bool &b, MDBinaryReader& r)
+{
+    b = r.readPOD<uint8_t>() != 0;
+}
+
+void readBinary(char &c, MDBinaryReader& r)
+{
+    c = r.readPOD<char>();
+}
+
+void readBinary(unsigned char &c, MDBinaryReader& r)
+{
+    c = r.readPOD<unsigned char>();
+}
+
+void readBinary(int &i, MDBinaryReader& r)
+{
+    i = r.readPOD<int>();
+}
+
+void readBinary(unsigned &i, MDBinaryReader& r)
+{
+    i = r.readPOD<unsigned>();
+}
+
+void readBinary(uint64_t &i, MDBinaryReader& r)
+{
+    i = r.readPOD<uint64_t>();
+}
+
+void readBinary(float &f, MDBinaryReader& r)
+{
+    f = r.readPOD<float>();
+}
+
+void readBinary(std::string &s, MDBinaryReader& r)
+{
+    uint32_t size = r.readPOD<uint32_t>();
+    s = r.readBytes(size).str();
+}
+
+void readBinary(Value* &val, MDBinaryReader& r)
+{
+    val = r.getValue(r.readPOD<uint32_t>());
+}
+
+void readBinary(Function* &funcPtr, MDBinaryReader& r)
+{
+    funcPtr = dyn_cast_or_null<Function>(r.getValue(r.readPOD<uint32_t>()));
+}
+
+void readBinary(GlobalVariable* &globalVar, MDBinaryReader& r)
+{
+    globalVar = dyn_cast_or_null<GlobalVariable>(r.getValue(r.readPOD<uint32_t>()));
+}
+
+template<typename T>
+void readBinary(std::vector<T> &vec, MDBinaryReader& r)
+{
+    uint32_t size = r.readPOD<uint32_t>();
+    if (!r.canRead(size))
+    {
+        return;
+    }
+    vec.reserve(vec.size() + size);
+    for (uint32_t k = 0; k < size && !r.failed(); k++)
+    {
+        T vecEle;
+        readBinary(vecEle, r);
+        vec.push_back(vecEle);
+    }
+}
+
+template<typename T, size_t s>
+void readBinary(std::array<T, s> &arr, MDBinaryReader& r)
+{
+    for (unsigned int k = 0; k < s; k++)
+    {
+        readBinary(arr[k], r);
+    }
+}
+
+template<typename Key, typename Value>
+void readBinary(std::map<Key, Value> &keyMD, MDBinaryReader& r)
+{
+    uint32_t size = r.readPOD<uint32_t>();
+    for (uint32_t k = 0; k < size && !r.failed(); k++)
+    {
+        std::pair<Key, Value> p;
+        readBinary(p.first, r);
+        readBinary(p.second, r);
+        keyMD.insert(p);
+    }
+}
+
+void readBinary(std::map<Function*, IGC::FunctionMetaData> &FuncMD, MDBinaryReader& r)
+{
+    uint32_t size = r.readPOD<uint32_t>();
+    for (uint32_t k = 0; k < size && !r.failed(); k++)
+    {
+        Function* F = dyn_cast_or_null<Function>(r.getValue(r.readPOD<uint32_t>()));
+        IGC::FunctionMetaData funcMD;
+        readBinary(funcMD, r);
+
+        // drop records of functions deleted after serialization
+        if (F != nullptr)
+        {
+            FuncMD[F] = funcMD;
+        }
+    }
+}
+
 void IGC::deserialize(IGC::ModuleMetaData &deserializeMD, const Module* module)
 {
     IGC::ModuleMetaData temp;
     deserializeMD = temp;
+
+    NamedMDNode* binaryRoot = module->getNamedMetadata(MDBinaryNodeName);
+    if (binaryRoot && binaryRoot->getNumOperands() != 0)
+    {
+        // serialize() drops the MDNode tree, so a blob that cannot be read
+        // means the metadata is lost and the compile cannot go on.
+        MDNode* node = binaryRoot->getOperand(0);
+        MDString* data = node->getNumOperands() == 2 ? dyn_cast_or_null<MDString>(node->getOperand(0)) : nullptr;
+        MDNode* values = node->getNumOperands() == 2 ? dyn_cast_or_null<MDNode>(node->getOperand(1)) : nullptr;
+        if (!data || !values)
+        {
+            report_fatal_error("malformed IGC metadata");
+        }
+
+        MDBinaryReader r(data->getString(), values);
+        if (r.readPOD<uint32_t>() != MDBinaryMagic ||
+            r.readPOD<uint32_t>() != MDBinaryLayoutHash)
+        {
+            report_fatal_error("IGC metadata was written by an incompatible compiler");
+        }
+        readBinary(deserializeMD, r);
+        if (r.failed())
+        {
+            report_fatal_error("truncated IGC metadata");
+        }
+        return;
+    }
+
     NamedMDNode* root = module->getNamedMetadata("IGCMetadata");
     if (!root) { return; } //module has not been serialized with IGCMetadata yet
     MDNode* moduleRoot = root->getOperand(0);
@@ -339,6 +735,34 @@ void IGC::deserialize(IGC::ModuleMetaData &deserializeMD, const Module* module)
 
 void IGC::serialize(const IGC::ModuleMetaData &moduleMD, Module* module)
 {
+    NamedMDNode* treeMetadata = module->getNamedMetadata("IGCMetadata");
+    if (treeMetadata)
+    {
+        module->eraseNamedMetadata(treeMetadata);
+    }
+
+    NamedMDNode* LLVMMetadata = module->getNamedMetadata(MDBinaryNodeName);
+    if (LLVMMetadata)
+    {
+        LLVMMetadata->dropAllReferences();
+    }
+    LLVMMetadata = module->getOrInsertNamedMetadata(MDBinaryNodeName);
+
+    MDBinaryWriter w(module);
+    w.writePOD(MDBinaryMagic);
+    w.writePOD(MDBinaryLayoutHash);
+    writeBinary(moduleMD, w);
+    LLVMMetadata->addOperand(w.createNode());
+}
+
+void IGC::serializeAsNodeTree(const IGC::ModuleMetaData &moduleMD, Module* module)
+{
+    NamedMDNode* binaryMetadata = module->getNamedMetadata(MDBinaryNodeName);
+    if (binaryMetadata)
+    {
+        module->eraseNamedMetadata(binaryMetadata);
+    }
+
     NamedMDNode* LLVMMetadata = module->getNamedMetadata("IGCMetadata");
     if(LLVMMetadata)
     {
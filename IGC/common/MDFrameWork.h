@@ -347,7 +347,12 @@ namespace IGC
         unsigned int privateMemoryPerWI = 0;
         std::array<uint64_t, NUM_SHADER_RESOURCE_VIEW_SIZE> m_ShaderResourceViewMcsMask{};
     };
+    // Stores the metadata as a compact binary blob (named metadata
+    // "IGCMetadataBin"); deserialize() also accepts the MDNode tree form.
     void serialize(const IGC::ModuleMetaData &moduleMD, llvm::Module* module);
+    // Stores the metadata as a human readable MDNode tree ("IGCMetadata"),
+    // used for IR dumps.
+    void serializeAsNodeTree(const IGC::ModuleMetaData &moduleMD, llvm::Module* module);
     void deserialize(IGC::ModuleMetaData &deserializedMD, const llvm::Module* module);
 
 }
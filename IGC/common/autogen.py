@@ -29,6 +29,8 @@
 import os
 import sys
 import errno
+import re
+import zlib
 
 # usage: autogen.py <path_to_MDFrameWork.h> <path_to_MDNodeFuncs.gen>
 __MDFrameWorkFile__ = sys.argv[1]
@@ -168,6 +170,24 @@ def printEnumReadCalls(enumName):
         output.write("        .Case(\""+ item + "\", IGC::"+ item + ")\n")
     output.write("        .Default((IGC::" + enumName + ")(0));\n")
 
+def printBinaryWriteCalls(structName):
+    for item in structDataMembers:
+        item = item[:-1]
+        output.write("    writeBinary(" + structName + "Var" + "." + item + ", w);\n")
+
+def printEnumBinaryWriteCalls(enumName):
+    output.write("    writeBinary((int)" + enumName + "Var, w);\n")
+
+def printBinaryReadCalls(structName):
+    for item in structDataMembers:
+        item = item[:-1]
+        output.write("    readBinary(" + structName + "Var" + "." + item + ", r);\n")
+
+def printEnumBinaryReadCalls(enumName):
+    output.write("    int val = 0;\n")
+    output.write("    readBinary(val, r);\n")
+    output.write("    " + enumName + "Var = (IGC::" + enumName + ")val;\n")
+
 def emitCodeBlock(names, declType, fmtFn, extractFn, printFn):
     for item in names:
         foundStruct = False
@@ -227,10 +247,73 @@ def emitStructReadNode():
         return "void readNode( IGC::" + item + " &" + item + "Var," + " MDNode* node)\n"
     emitCodeBlock(structureNames, "struct", fmtFn, extractVars, printReadCalls)
 
+def emitEnumWriteBinary():
+    def fmtFn(item):
+        return "void writeBinary(IGC::" + item + " " + item + "Var, MDBinaryWriter& w)\n"
+    emitCodeBlock(enumNames, "enum", fmtFn, extractEnumVal, printEnumBinaryWriteCalls)
+
+def emitStructWriteBinary():
+    def fmtFn(item):
+        return "void writeBinary(const IGC::" + item + "& " + item + "Var, MDBinaryWriter& w)\n"
+    emitCodeBlock(structureNames, "struct", fmtFn, extractVars, printBinaryWriteCalls)
+
+def emitEnumReadBinary():
+    def fmtFn(item):
+        return "void readBinary(IGC::" + item + " &" + item + "Var, MDBinaryReader& r)\n"
+    emitCodeBlock(enumNames, "enum", fmtFn, extractEnumVal, printEnumBinaryReadCalls)
+
+def emitStructReadBinary():
+    def fmtFn(item):
+        return "void readBinary(IGC::" + item + " &" + item + "Var, MDBinaryReader& r)\n"
+    emitCodeBlock(structureNames, "struct", fmtFn, extractVars, printBinaryReadCalls)
+
+# The binary metadata blob is only readable by a compiler with the same
+# serialized layout, so its hash doubles as the blob version. Only the member
+# declarations of the serialized structs and enums are hashed: comments and
+# default values do not change the layout.
+def normalizeMember(line, isEnum):
+    line = line.split("//")[0]
+    if not isEnum:
+        line = re.sub(r"\s*=[^;]*;", ";", line)
+        line = re.sub(r"\{[^;]*\};", ";", line)
+    return " ".join(line.split())
+
+def collectLayout():
+    layout = []
+    declNames = set(["struct " + name for name in structureNames] +
+                    ["enum " + name for name in enumNames])
+    with open(__MDFrameWorkFile__, 'r') as file:
+        decl = None
+        for line in file:
+            code = " ".join(line.split("//")[0].split())
+            if decl is None:
+                words = code.split()
+                if len(words) >= 2 and (words[0] + " " + words[1]) in declNames:
+                    decl = words[0] + " " + words[1]
+                    layout.append(decl)
+                continue
+            if code.find("};") != -1:
+                decl = None
+                continue
+            member = normalizeMember(code, decl.startswith("enum"))
+            if member != "" and member != "{":
+                layout.append(member)
+    return layout
+
+def emitLayoutHash():
+    layout = "\n".join(collectLayout())
+    layoutHash = zlib.crc32(layout.encode("utf-8")) & 0xffffffff
+    output.write("static const uint32_t MDBinaryLayoutHash = 0x%08x;\n\n" % layoutHash)
+
 def genCode():
+    emitLayoutHash()
     emitEnumCreateNode()
     emitStructCreateNode()
     emitEnumReadNode()
     emitStructReadNode()
+    emitEnumWriteBinary()
+    emitStructWriteBinary()
+    emitEnumReadBinary()
+    emitStructReadBinary()
 
 genCode()
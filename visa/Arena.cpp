@@ -25,6 +25,7 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 ======================= end_copyright_notice ==================================*/
 
 #include "Arena.h"
+#include "VISADefines.h"
 
 #ifdef COLLECT_ALLOCATION_STATS
 int numAllocations = 0;
@@ -62,6 +63,65 @@ ArenaHeader::AllocSpace (size_t size)
     return allocSpace;
 }
 
+// Arenas of destroyed managers are kept per thread and reused by the next
+// managers created, so the many short lived managers (per pass, per RA
+// iteration, per scheduling block) don't each go back to the system heap.
+// The cache lives until the thread's builder is destroyed.
+#ifndef ANDROID
+static _THREAD ArenaHeader* cachedArenas = 0;
+static _THREAD size_t cachedArenaBytes = 0;
+#endif
+
+unsigned char*
+ArenaManager::TakeCachedArena(size_t& dataSize)
+{
+#ifndef ANDROID
+    for (ArenaHeader** link = &cachedArenas; *link; link = &(*link)->_nextArena)
+    {
+        ArenaHeader* arena = *link;
+        // don't spend a large arena on a small request
+        if (arena->size >= dataSize && arena->size <= dataSize * 2)
+        {
+            *link = arena->_nextArena;
+            cachedArenaBytes -= arena->size;
+            dataSize = arena->size;
+            return (unsigned char*) arena;
+        }
+    }
+#endif
+    return 0;
+}
+
+bool
+ArenaManager::CacheArena(ArenaHeader* arena)
+{
+#ifndef ANDROID
+    if (cachedArenaBytes + arena->size <= ARENA_CACHE_MAX_BYTES)
+    {
+        arena->_nextArena = cachedArenas;
+        cachedArenas = arena;
+        cachedArenaBytes += arena->size;
+        return true;
+    }
+#endif
+    return false;
+}
+
+void
+ArenaManager::ReleaseArenaCache()
+{
+#ifndef ANDROID
+    while (cachedArenas)
+    {
+        unsigned char* killed = (unsigned char*) cachedArenas;
+        cachedArenas = cachedArenas->_nextArena;
+        delete [] killed;
+    }
+
+    cachedArenaBytes = 0;
+#endif
+}
+
 void
 ArenaManager::FreeArenas()
 {
@@ -70,10 +130,17 @@ ArenaManager::FreeArenas()
 #ifdef COLLECT_ALLOCATION_STATS
         currentMallocSize -= _arenas->size;
 #endif
-        unsigned char* killed = (unsigned char*) _arenas;
+        ArenaHeader* killed = _arenas;
         _arenas = _arenas->_nextArena;
-        delete [] killed;
+        if (!CacheArena(killed))
+        {
+            delete [] (unsigned char*) killed;
+        }
     }
 
     _arenas = 0;
+    for (auto& freeList : _freeLists)
+    {
+        freeList = 0;
+    }
 }
@@ -34,11 +34,19 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <assert.h>
 #include <stdlib.h>
 #include <iostream>
+#include <string.h>
 
 #include "Option.h"
 
 //#define COLLECT_ALLOCATION_STATS
 
+// Freed blocks up to this size are recycled through per-size free lists.
+#define ARENA_FREE_LIST_MAX_SIZE 128
+
+// Upper bound of the memory kept by the per-thread cache of arenas released
+// by destroyed managers.
+#define ARENA_CACHE_MAX_BYTES (4 * 1024 * 1024)
+
 #ifdef COLLECT_ALLOCATION_STATS
 extern int numAllocations;
 extern int numMallocCalls;
@@ -123,6 +131,10 @@ namespace vISA
             _arenas(0),
             _defaultArenaSize(defaultArenaSize)
         {
+            for (auto& freeList : _freeLists)
+            {
+                freeList = NULL;
+            }
             CreateArena(_defaultArenaSize);
         }
 
@@ -142,7 +154,12 @@ namespace vISA
 
             if (size)
             {
-                space = _arenas->AllocSpace(size);
+                space = PopFreeList(size);
+
+                if (space == 0)
+                {
+                    space = _arenas->AllocSpace(size);
+                }
 
                 if (space == 0)
                 {
@@ -161,12 +178,65 @@ namespace vISA
             return space;
         }
 
+        // Give back a block obtained from AllocDataSpace(size). Small blocks
+        // are handed out again by the next allocation of the same size; the
+        // others stay in their arena until the manager is destroyed.
+        void FreeDataSpace(void* space, size_t size)
+        {
+#if !defined(NDEBUG) && defined(vISA_DEBUG_MEM_ALLOC)
+            return;
+#endif
+            size = ArenaHeader::WordAlign(size);
+            if (space == 0 || size < sizeof(void*) || size > ARENA_FREE_LIST_MAX_SIZE)
+            {
+                return;
+            }
+            assert(Owns(space) && "block freed to a manager that does not own it");
+
+            // arena memory is only word aligned, so the link is copied in
+            void*& freeList = _freeLists[size / 4];
+            memcpy(space, &freeList, sizeof(void*));
+            freeList = space;
+        }
+
+        bool Owns(const void* space) const
+        {
+            for (ArenaHeader* arena = _arenas; arena != NULL; arena = arena->_nextArena)
+            {
+                if (space >= arena->GetArenaData() && space < arena->_lastByte)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void* PopFreeList(size_t size)
+        {
+            size = ArenaHeader::WordAlign(size);
+            if (size > ARENA_FREE_LIST_MAX_SIZE)
+            {
+                return 0;
+            }
+
+            void*& freeList = _freeLists[size / 4];
+            void* space = freeList;
+            if (space)
+            {
+                memcpy(&freeList, space, sizeof(void*));
+            }
+            return space;
+        }
+
         ArenaHeader* CreateArena(size_t size)
         {
             size_t arenaDataSize = (size > _defaultArenaSize) ? size : _defaultArenaSize;
             arenaDataSize = ArenaHeader::WordAlign(arenaDataSize);
-            unsigned char * arena =
-                new unsigned char[ArenaHeader::GetArenaSize(arenaDataSize)];
+            unsigned char * arena = TakeCachedArena(arenaDataSize);
+            if (arena == NULL)
+            {
+                arena = new unsigned char[ArenaHeader::GetArenaSize(arenaDataSize)];
+            }
 
             ArenaHeader* newArena = new (arena)ArenaHeader(arenaDataSize, _arenas);
             // Add new arena to the head of queue
@@ -202,10 +272,44 @@ namespace vISA
 
         void FreeArenas();
 
+        // Reuse an arena of a destroyed manager holding at least dataSize
+        // bytes; dataSize is updated to the size of the arena returned.
+        static unsigned char* TakeCachedArena(size_t& dataSize);
+        static bool CacheArena(ArenaHeader* arena);
+
+        // Bytes obtained from the system, and the part of it handed out.
+        size_t GetAllocatedBytes() const
+        {
+            size_t bytes = 0;
+            for (ArenaHeader* arena = _arenas; arena != NULL; arena = arena->_nextArena)
+            {
+                bytes += arena->size;
+            }
+            return bytes;
+        }
+
+        size_t GetUsedBytes() const
+        {
+            size_t bytes = 0;
+            for (ArenaHeader* arena = _arenas; arena != NULL; arena = arena->_nextArena)
+            {
+                bytes += arena->_nextByte - arena->GetArenaData();
+            }
+            return bytes;
+        }
+
         // Data
 
         ArenaHeader * _arenas;
         const size_t  _defaultArenaSize;
+
+        // Heads of the free lists, indexed by word aligned size / 4.
+        void* _freeLists[ARENA_FREE_LIST_MAX_SIZE / 4 + 1];
+
+    public:
+
+        // Free the arenas cached by the calling thread.
+        static void ReleaseArenaCache();
     };
 }
 #endif
@@ -354,6 +354,9 @@ int CISA_IR_Builder::DestroyBuilder(CISA_IR_Builder *builder)
 
     delete builder;
 
+    // arenas cached while compiling this builder's kernels
+    Mem_Manager::releaseArenaCache();
+
     return CM_SUCCESS;
 }
 
@@ -763,6 +766,51 @@ int CISA_IR_Builder::ParseVISAText(const std::string& visaFile)
 #endif
 }
 
+// Parses an inline asm fragment directly into an existing kernel built through
+// the builder API. Variables it refers to must have been named in the kernel.
+int CISA_IR_Builder::ParseVISAInlineAsm(VISAKernelImpl* kernel, const std::string& asmText)
+{
+#if defined(__linux__) || defined(_WIN64) || defined(_WIN32)
+    // Direct output of parser to null
+#if defined(_WIN64) || defined(_WIN32)
+    CISAout = fopen("nul", "w");
+#else
+    CISAout = fopen("/dev/null", "w");
+#endif
+
+    // The parser always appends to the current kernel of pCisaBuilder, and
+    // only records the names of variables it declares in parse mode.
+    CISA_IR_Builder* savedBuilder = pCisaBuilder;
+    VISAKernelImpl* savedKernel = m_kernel;
+    bool savedParseMode = m_options.getOption(vISA_isParseMode);
+    pCisaBuilder = this;
+    m_kernel = kernel;
+    m_options.setOptionInternally(vISA_isParseMode, true);
+
+    int status = CM_SUCCESS;
+    YY_BUFFER_STATE asmBuf = CISA_scan_string(asmText.c_str());
+    if (CISAparse() != 0)
+    {
+        // reported by the caller
+        status = CM_FAILURE;
+    }
+    CISA_delete_buffer(asmBuf);
+
+    m_options.setOptionInternally(vISA_isParseMode, savedParseMode);
+    m_kernel = savedKernel;
+    pCisaBuilder = savedBuilder;
+
+    if (CISAout)
+    {
+        fclose(CISAout);
+    }
+    return status;
+#else
+    assert(0 && "Asm parsing not supported on this platform");
+    return CM_FAILURE;
+#endif
+}
+
 // default size of the kernel mem manager in bytes
 #define KERNEL_MEM_SIZE    (4*1024*1024)
 int CISA_IR_Builder::Compile(const char* nameInput, std::ostream* os, bool emit_visa_only)
@@ -888,7 +936,23 @@ int CISA_IR_Builder::Compile(const char* nameInput, std::ostream* os, bool emit_
             {
                 kernels.push_back(kernel);
             }
+        }
+
+        std::map<std::string, G4_Kernel*> allFunctions;
+        for (auto func_it = functions.begin(); func_it != functions.end(); func_it++)
+        {
+            G4_Kernel* func = (*func_it)->getKernel();
+            allFunctions[std::string(func->getName())] = func;
+        }
 
+        // Compile functions ahead of kernels so that a caller already knows
+        // which caller-save registers its callees clobber when it inserts
+        // save/restore code around stack calls.
+        std::list<VISAKernelImpl*> compileOrder(functions);
+        compileOrder.insert(compileOrder.end(), kernels.begin(), kernels.end());
+        for (auto kernel : compileOrder)
+        {
+            kernel->getKernel()->setCompilationUnits(&allFunctions);
             m_currentKernel = kernel;
 
             int status =  kernel->compileFastPath();
@@ -919,12 +983,9 @@ int CISA_IR_Builder::Compile(const char* nameInput, std::ostream* os, bool emit_
             saveFCallState( function->getKernel(), savedFCallState );
         }
 
-        std::map<std::string, G4_Kernel*> allFunctions;
-
         for (auto func_it = functions.begin(); func_it != functions.end(); func_it++)
         {
             G4_Kernel* func = (*func_it)->getKernel();
-            allFunctions[std::string(func->getName())] = func;
             if (m_options.getOption(vISA_GenerateDebugInfo))
             {
                 func->getKernelDebugInfo()->resetRelocOffset();
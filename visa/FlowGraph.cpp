@@ -40,6 +40,7 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "queue"
 #include "BitSet.h"
 #include "PhyRegUsage.h"
+#include "RegAlloc.h"
 #include "visa_wa.h"
 #include "CFGStructurizer.h"
 #include "DebugInfo.h"
@@ -948,6 +949,7 @@ void FlowGraph::constructFlowGraph(INST_LIST& instlist)
     builder->materializeGlobalImm(getEntryBB());
     normalizeRegionDescriptors();
     localDataFlowAnalysis();
+    pKernel->setAnalysisValid(ANALYSIS_DEFUSE);
 }
 
 void FlowGraph::normalizeRegionDescriptors()
@@ -5693,9 +5695,39 @@ G4_Kernel::~G4_Kernel()
         gtPinInfo->~gtPinData();
     }
 
+    delete pointsToAnalysis;
+
     Declares.clear();
 }
 
+void G4_Kernel::computeAnalyses(unsigned analyses)
+{
+    unsigned missing = analyses & ~validAnalyses;
+
+    if (missing & ANALYSIS_DEFUSE)
+    {
+        fg.resetLocalDataFlowData();
+        fg.localDataFlowAnalysis();
+    }
+
+    if (missing & ANALYSIS_POINTSTO)
+    {
+        // Points-to sets are indexed by BB id and address variable id, so
+        // they have to be rebuilt from scratch.
+        delete pointsToAnalysis;
+        pointsToAnalysis = new PointsToAnalysis(Declares, fg.getNumBB());
+        pointsToAnalysis->doPointsToAnalysis(fg);
+    }
+
+    validAnalyses |= missing;
+}
+
+PointsToAnalysis& G4_Kernel::getPointsToAnalysis()
+{
+    computeAnalyses(ANALYSIS_POINTSTO);
+    return *pointsToAnalysis;
+}
+
 //
 // rename non-root declares to their root decl name to make
 // it easier to read IR dump
@@ -5886,6 +5918,91 @@ unsigned int G4_Kernel::getNumCalleeSaveRegs()
     return totalGRFs - calleeSaveStart() - getNumScratchRegs();
 }
 
+G4_Kernel* G4_Kernel::getCompilationUnit(const std::string& name) const
+{
+    if (!compilationUnits)
+    {
+        return nullptr;
+    }
+    auto it = compilationUnits->find(name);
+    return it != compilationUnits->end() ? it->second : nullptr;
+}
+
+void G4_Kernel::computeCallerSaveClobbers()
+{
+    unsigned int callerSaveNumGRF = getCallerSaveLastGRF() + 1;
+    std::vector<bool> clobbers(callerSaveNumGRF, false);
+    bool clobbersAll = false;
+
+    auto markRows = [&](unsigned int startByte, unsigned int endByte)
+    {
+        for (unsigned int i = startByte / getGRFSize();
+            i <= endByte / getGRFSize() && i < callerSaveNumGRF; i++)
+        {
+            clobbers[i] = true;
+        }
+    };
+
+    for (auto bb : fg)
+    {
+        for (auto inst : *bb)
+        {
+            if (inst->opcode() == G4_pseudo_fcall)
+            {
+                // Registers clobbered by nested calls are clobbered by this
+                // function as well.
+                G4_Kernel* callee = inst->asCFInst()->isIndirectCall() ? nullptr :
+                    getCompilationUnit(inst->asCFInst()->getCallee());
+                auto calleeClobbers = callee ? callee->getCallerSaveClobbers() : nullptr;
+                if (!calleeClobbers)
+                {
+                    clobbersAll = true;
+                    break;
+                }
+                for (unsigned int i = 0; i < callerSaveNumGRF; i++)
+                {
+                    clobbers[i] = clobbers[i] || (*calleeClobbers)[i];
+                }
+            }
+
+            G4_DstRegRegion* dst = inst->getDst();
+            if (!dst || dst->isNullReg())
+            {
+                continue;
+            }
+            if (dst->isIndirect())
+            {
+                clobbersAll = true;
+                break;
+            }
+
+            G4_VarBase* base = dst->getBase();
+            if (base->isGreg())
+            {
+                unsigned int startByte = (base->asGreg()->getRegNum() + dst->getRegOff()) * getGRFSize() +
+                    dst->getSubRegOff() * dst->getElemSize();
+                markRows(startByte, startByte + dst->getRightBound() - dst->getLeftBound());
+            }
+            else if (base->isRegVar() && base->asRegVar()->getPhyReg() &&
+                base->asRegVar()->getPhyReg()->isGreg())
+            {
+                markRows(dst->getLinearizedStart(), dst->getLinearizedEnd());
+            }
+        }
+        if (clobbersAll)
+        {
+            break;
+        }
+    }
+
+    if (clobbersAll)
+    {
+        clobbers.assign(callerSaveNumGRF, true);
+    }
+    callerSaveClobbers.swap(clobbers);
+    hasCallerSaveClobbers = true;
+}
+
 void RelocationEntry::doRelocation(const G4_Kernel& kernel, void* binary, uint32_t binarySize)
 {
     // FIXME: nothing to do here
@@ -48,6 +48,7 @@ namespace vISA
 class IR_Builder;
 class PhyRegSummary;
 class KernelDebugInfo;
+class PointsToAnalysis;
 
 //
 // Forward definitions
@@ -1355,6 +1356,19 @@ public:
     void dump() const;
 };
 
+//
+// Analyses whose results are cached on G4_Kernel across optimizer passes.
+// Passes declare the analyses they require and the ones they preserve (see
+// Optimizer::PassInfo), so an analysis is only recomputed once some pass
+// has invalidated it.
+//
+enum G4_AnalysisKind
+{
+    ANALYSIS_NONE     = 0,
+    ANALYSIS_DEFUSE   = 0x1,    // local def-use edges, see FlowGraph::localDataFlowAnalysis()
+    ANALYSIS_POINTSTO = 0x2,    // points-to sets of address variables
+    ANALYSIS_ALL      = ANALYSIS_DEFUSE | ANALYSIS_POINTSTO
+};
 
 class G4_Kernel
 {
@@ -1391,9 +1405,21 @@ class G4_Kernel
 
     unsigned int callerSaveLastGRF;
 
+    // Caller-save GRFs written by this function or anything it calls. Only
+    // valid once the function has been register allocated.
+    std::vector<bool> callerSaveClobbers;
+    bool hasCallerSaveClobbers = false;
+
+    // All functions of the compilation, used to look up callees by name.
+    const std::map<std::string, G4_Kernel*>* compilationUnits = nullptr;
+
     bool m_hasIndirectCall = false;
     bool m_isExternFunction = false;
 
+    // Mask of G4_AnalysisKind whose cached results are up to date.
+    unsigned validAnalyses = ANALYSIS_NONE;
+    PointsToAnalysis* pointsToAnalysis = nullptr;
+
 public:
     typedef std::vector<RelocationEntry> RelocationTableTy;
 
@@ -1511,6 +1537,14 @@ public:
     bool getChannelSlicing() { return channelSliced; }
     unsigned int getSimdSizeWithSlicing() { return channelSliced ? simdSize/2 : simdSize; }
 
+    // Cached analyses. computeAnalyses() only recomputes the analyses that
+    // are not valid anymore.
+    bool isAnalysisValid(unsigned analyses) const { return (validAnalyses & analyses) == analyses; }
+    void setAnalysisValid(unsigned analyses) { validAnalyses |= analyses; }
+    void invalidateAnalyses(unsigned analyses) { validAnalyses &= ~analyses; }
+    void computeAnalyses(unsigned analyses);
+    PointsToAnalysis& getPointsToAnalysis();
+
     void setHasAddrTaken(bool val) { hasAddrTaken = val; }
     bool getHasAddrTaken() { return hasAddrTaken;  }
 
@@ -1573,6 +1607,20 @@ public:
     static unsigned int getNumScratchRegs() { return 3; }
     unsigned int getNumCalleeSaveRegs();
 
+    void setCompilationUnits(const std::map<std::string, G4_Kernel*>* units)
+    {
+        compilationUnits = units;
+    }
+    G4_Kernel* getCompilationUnit(const std::string& name) const;
+
+    // Record the caller-save GRFs this function may clobber. Callers use the
+    // result to skip saving registers the callee leaves intact.
+    void computeCallerSaveClobbers();
+    const std::vector<bool>* getCallerSaveClobbers() const
+    {
+        return hasCallerSaveClobbers ? &callerSaveClobbers : nullptr;
+    }
+
     void renameAliasDeclares();
 
     bool hasIndirectCall() const
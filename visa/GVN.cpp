@@ -0,0 +1,589 @@
+/*===================== begin_copyright_notice ==================================
+
+Copyright (c) 2017 Intel Corporation
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+======================= end_copyright_notice ==================================*/
+
+#include "GVN.h"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+using namespace vISA;
+
+static uint64_t hashCombine(uint64_t seed, uint64_t val)
+{
+    return seed ^ (val + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+
+// Call/return edges are not modeled precisely enough by the dominator
+// computation below, so kernels with subroutines or stack calls are skipped.
+bool GVN::hasUnsupportedCF()
+{
+    for (auto bb : fg)
+    {
+        if (bb->isEndWithCall() || bb->isEndWithFCall() || bb->isEndWithFRet() ||
+            (bb->getBBType() & G4_BB_RETURN_TYPE))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Compute immediate dominators with the iterative algorithm from
+// Cooper, Harvey and Kennedy on the reverse post order of the CFG.
+void GVN::computeDominators()
+{
+    unsigned numBBIds = 0;
+    for (auto bb : fg)
+    {
+        numBBIds = std::max(numBBIds, bb->getId() + 1);
+    }
+    idom.assign(numBBIds, nullptr);
+    rpoNum.assign(numBBIds, UINT_MAX);
+    inLoop.assign(numBBIds, false);
+
+    std::vector<bool> visited(numBBIds, false);
+    std::vector<std::pair<G4_BB*, BB_LIST_ITER>> stack;
+    G4_BB* entryBB = fg.getEntryBB();
+    visited[entryBB->getId()] = true;
+    stack.push_back(std::make_pair(entryBB, entryBB->Succs.begin()));
+    while (!stack.empty())
+    {
+        G4_BB* bb = stack.back().first;
+        if (stack.back().second == bb->Succs.end())
+        {
+            rpo.push_back(bb);
+            stack.pop_back();
+            continue;
+        }
+        G4_BB* succ = *(stack.back().second++);
+        if (!visited[succ->getId()])
+        {
+            visited[succ->getId()] = true;
+            stack.push_back(std::make_pair(succ, succ->Succs.begin()));
+        }
+    }
+    std::reverse(rpo.begin(), rpo.end());
+    for (unsigned i = 0, e = (unsigned)rpo.size(); i < e; ++i)
+    {
+        rpoNum[rpo[i]->getId()] = i;
+    }
+
+    auto intersect = [this](G4_BB* bb1, G4_BB* bb2)
+    {
+        while (bb1 != bb2)
+        {
+            while (rpoNum[bb1->getId()] > rpoNum[bb2->getId()])
+                bb1 = idom[bb1->getId()];
+            while (rpoNum[bb2->getId()] > rpoNum[bb1->getId()])
+                bb2 = idom[bb2->getId()];
+        }
+        return bb1;
+    };
+
+    idom[entryBB->getId()] = entryBB;
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (auto bb : rpo)
+        {
+            if (bb == entryBB)
+                continue;
+
+            G4_BB* newIDom = nullptr;
+            for (auto pred : bb->Preds)
+            {
+                if (!idom[pred->getId()])
+                    continue;
+                newIDom = newIDom ? intersect(pred, newIDom) : pred;
+            }
+            if (newIDom != idom[bb->getId()])
+            {
+                idom[bb->getId()] = newIDom;
+                changed = true;
+            }
+        }
+    }
+}
+
+// A BB is in a loop if it belongs to a non-trivial SCC or branches to itself.
+// Unlike findNaturalLoops() this also covers irreducible cycles.
+void GVN::computeLoops()
+{
+    SCCAnalysis SCCFinder(fg);
+    SCCFinder.run();
+    for (auto it = SCCFinder.SCC_begin(), ie = SCCFinder.SCC_end(); it != ie; ++it)
+    {
+        if (it->getSize() < 2)
+            continue;
+        for (auto bit = it->body_begin(), be = it->body_end(); bit != be; ++bit)
+        {
+            inLoop[(*bit)->getId()] = true;
+        }
+    }
+    for (auto bb : fg)
+    {
+        if (std::find(bb->Succs.begin(), bb->Succs.end(), bb) != bb->Succs.end())
+        {
+            inLoop[bb->getId()] = true;
+        }
+    }
+}
+
+bool GVN::dominates(G4_BB* bb1, G4_BB* bb2)
+{
+    if (!idom[bb1->getId()] || !idom[bb2->getId()])
+    {
+        // unreachable code
+        return false;
+    }
+    G4_BB* entryBB = fg.getEntryBB();
+    while (bb2 != bb1)
+    {
+        if (bb2 == entryBB)
+            return false;
+        bb2 = idom[bb2->getId()];
+    }
+    return true;
+}
+
+// Check whether position pos1 in bb1 is executed before every execution of
+// position pos2 in bb2.
+bool GVN::isBefore(G4_BB* bb1, unsigned pos1, G4_BB* bb2, unsigned pos2)
+{
+    if (bb1 == bb2)
+    {
+        return pos1 < pos2;
+    }
+    return dominates(bb1, bb2);
+}
+
+bool GVN::isCandidateInst(G4_INST* inst)
+{
+    switch (inst->opcode())
+    {
+    case G4_mov:
+    case G4_add:
+    case G4_mul:
+    case G4_shl:
+    case G4_shr:
+    case G4_asr:
+    case G4_and:
+    case G4_or:
+    case G4_xor:
+    case G4_not:
+        break;
+    default:
+        return false;
+    }
+
+    // Values computed under a channel mask may differ between two sites
+    // even when their sources agree.
+    if (!inst->isWriteEnableInst() || inst->getPredicate() || inst->getCondMod() ||
+        inst->useAcc())
+    {
+        return false;
+    }
+
+    G4_DstRegRegion* dst = inst->getDst();
+    if (!dst || dst->getRegAccess() != Direct || !dst->getBase()->isRegVar() ||
+        dst->isAccRegValid())
+    {
+        return false;
+    }
+    return true;
+}
+
+void GVN::collectDefsAndUses()
+{
+    for (auto bb : fg)
+    {
+        unsigned pos = 0;
+        for (auto it = bb->begin(), ie = bb->end(); it != ie; ++it, ++pos)
+        {
+            G4_INST* inst = (*it);
+            instPos[inst] = pos;
+
+            G4_DstRegRegion* dst = inst->getDst();
+            if (dst && dst->getTopDcl())
+            {
+                DclInfo& info = dclInfo[dst->getTopDcl()];
+                info.dcl = dst->getTopDcl();
+                if (info.defs.empty())
+                {
+                    info.bb = bb;
+                    info.firstPos = pos;
+                }
+                else if (info.bb != bb)
+                {
+                    info.bb = nullptr;
+                }
+                info.lastPos = pos;
+                info.defInLoop |= inLoop[bb->getId()];
+                info.defs.push_back(std::make_pair(bb, it));
+                if (!isCandidateInst(inst))
+                {
+                    info.candidate = false;
+                }
+            }
+
+            for (unsigned i = 0, numSrc = inst->getNumSrc(); i < numSrc; ++i)
+            {
+                G4_Operand* src = inst->getSrc(i);
+                if (!src || !src->getTopDcl())
+                    continue;
+
+                DclInfo& info = dclInfo[src->getTopDcl()];
+                info.dcl = src->getTopDcl();
+                // Only direct regions of the declare itself can be renamed.
+                if (!src->isSrcRegRegion() ||
+                    src->asSrcRegRegion()->getRegAccess() != Direct ||
+                    src->getBase() != info.dcl->getRegVar())
+                {
+                    info.candidate = false;
+                    continue;
+                }
+                info.uses.push_back(std::make_pair(inst, i));
+            }
+        }
+    }
+
+    // Accesses through an alias use offsets relative to the alias, so
+    // neither side of a replacement may be aliased.
+    for (auto dcl : kernel.Declares)
+    {
+        if (dcl->getAliasDeclare())
+        {
+            G4_Declare* rootDcl = dcl->getRootDeclare();
+            DclInfo& info = dclInfo[rootDcl];
+            info.dcl = rootDcl;
+            info.candidate = false;
+        }
+    }
+}
+
+// A source reads the same bits wherever a value computed from it is
+// available: every def of the source comes before the value and none of
+// them can be executed again afterwards.
+bool GVN::isInvariantSrc(G4_Operand* src, DclInfo& user)
+{
+    if (src->isImm())
+    {
+        return true;
+    }
+    if (!src->isSrcRegRegion() || src->asSrcRegRegion()->getRegAccess() != Direct ||
+        !src->getBase()->isRegVar())
+    {
+        return false;
+    }
+
+    G4_Declare* topDcl = src->getTopDcl();
+    if (!topDcl || topDcl == user.dcl || topDcl->getAddressed() || !topDcl->useGRF())
+    {
+        return false;
+    }
+
+    auto it = dclInfo.find(topDcl);
+    if (it == dclInfo.end())
+    {
+        return true;
+    }
+    DclInfo& srcInfo = it->second;
+    if (srcInfo.defInLoop)
+    {
+        return false;
+    }
+    for (auto& def : srcInfo.defs)
+    {
+        if (!isBefore(def.first, instPos[*def.second], user.bb, user.firstPos))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool GVN::isValidCandidate(DclInfo& info)
+{
+    G4_Declare* dcl = info.dcl;
+    if (!info.candidate || !info.bb || info.defs.empty() ||
+        info.defs.size() > MaxGVNDefs ||
+        !idom[info.bb->getId()] ||
+        dcl->getRegFile() != G4_GRF ||
+        dcl->getNumRows() > MaxGVNRows ||
+        dcl->getAddressed() || dcl->isInput() || dcl->isOutput())
+    {
+        return false;
+    }
+
+    for (auto& def : info.defs)
+    {
+        G4_INST* inst = *def.second;
+        for (unsigned i = 0, numSrc = inst->getNumSrc(); i < numSrc; ++i)
+        {
+            G4_Operand* src = inst->getSrc(i);
+            if (src && !isInvariantSrc(src, info))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+uint64_t GVN::hashDefs(DclInfo& info)
+{
+    uint64_t hash = hashCombine(info.dcl->getElemType(), info.dcl->getTotalElems());
+    for (auto& def : info.defs)
+    {
+        G4_INST* inst = *def.second;
+        G4_DstRegRegion* dst = inst->getDst();
+        hash = hashCombine(hash, inst->opcode());
+        hash = hashCombine(hash, inst->getExecSize());
+        hash = hashCombine(hash, dst->getLeftBound());
+        hash = hashCombine(hash, dst->getType());
+        for (unsigned i = 0, numSrc = inst->getNumSrc(); i < numSrc; ++i)
+        {
+            G4_Operand* src = inst->getSrc(i);
+            if (!src)
+                continue;
+            if (src->isImm())
+            {
+                hash = hashCombine(hash, (uint64_t)src->asImm()->getImm());
+            }
+            else
+            {
+                hash = hashCombine(hash, (uint64_t)(uintptr_t)src->getBase());
+                hash = hashCombine(hash, src->getLeftBound());
+            }
+            hash = hashCombine(hash, src->getType());
+        }
+    }
+    return hash;
+}
+
+bool GVN::srcsMatch(G4_Operand* src1, G4_Operand* src2)
+{
+    if (!src1 || !src2)
+    {
+        return src1 == src2;
+    }
+    if (src1->getType() != src2->getType())
+    {
+        return false;
+    }
+    if (src1->isImm() && src2->isImm())
+    {
+        return src1->asImm()->getImm() == src2->asImm()->getImm();
+    }
+    if (src1->isSrcRegRegion() && src2->isSrcRegRegion())
+    {
+        G4_SrcRegRegion* rgn1 = src1->asSrcRegRegion();
+        G4_SrcRegRegion* rgn2 = src2->asSrcRegRegion();
+        const RegionDesc* desc1 = rgn1->getRegion();
+        const RegionDesc* desc2 = rgn2->getRegion();
+        return rgn1->getBase() == rgn2->getBase() &&
+            rgn1->getModifier() == rgn2->getModifier() &&
+            rgn1->getRegOff() == rgn2->getRegOff() &&
+            rgn1->getSubRegOff() == rgn2->getSubRegOff() &&
+            desc1->vertStride == desc2->vertStride &&
+            desc1->width == desc2->width &&
+            desc1->horzStride == desc2->horzStride;
+    }
+    return false;
+}
+
+bool GVN::defsMatch(DclInfo& info1, DclInfo& info2)
+{
+    if (info1.defs.size() != info2.defs.size())
+    {
+        return false;
+    }
+    for (unsigned i = 0, e = (unsigned)info1.defs.size(); i < e; ++i)
+    {
+        G4_INST* inst1 = *info1.defs[i].second;
+        G4_INST* inst2 = *info2.defs[i].second;
+        G4_DstRegRegion* dst1 = inst1->getDst();
+        G4_DstRegRegion* dst2 = inst2->getDst();
+        if (inst1->opcode() != inst2->opcode() ||
+            inst1->getExecSize() != inst2->getExecSize() ||
+            inst1->getMaskOption() != inst2->getMaskOption() ||
+            inst1->getSaturate() != inst2->getSaturate() ||
+            inst1->getNumSrc() != inst2->getNumSrc() ||
+            dst1->getRegOff() != dst2->getRegOff() ||
+            dst1->getSubRegOff() != dst2->getSubRegOff() ||
+            dst1->getHorzStride() != dst2->getHorzStride() ||
+            dst1->getType() != dst2->getType())
+        {
+            return false;
+        }
+        for (unsigned j = 0, numSrc = inst1->getNumSrc(); j < numSrc; ++j)
+        {
+            if (!srcsMatch(inst1->getSrc(j), inst2->getSrc(j)))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool GVN::canReplace(DclInfo& leader, DclInfo& info)
+{
+    // The leader must keep its value from its last def on.
+    if (leader.defInLoop ||
+        !isBefore(leader.bb, leader.lastPos, info.bb, info.firstPos))
+    {
+        return false;
+    }
+
+    G4_Declare* leaderDcl = leader.dcl;
+    G4_Declare* dcl = info.dcl;
+    if (leaderDcl->getElemType() != dcl->getElemType() ||
+        leaderDcl->getTotalElems() != dcl->getTotalElems() ||
+        leaderDcl->getNumRows() != dcl->getNumRows())
+    {
+        return false;
+    }
+    return defsMatch(leader, info);
+}
+
+void GVN::replaceDcl(DclInfo& leader, DclInfo& info)
+{
+    G4_Declare* leaderDcl = leader.dcl;
+    G4_Declare* dcl = info.dcl;
+
+    // Ensure most constrained alignment gets applied to the leader
+    if (!leaderDcl->isEvenAlign() && dcl->isEvenAlign())
+    {
+        leaderDcl->setEvenAlign();
+    }
+    if (dcl->getSubRegAlign() > leaderDcl->getSubRegAlign())
+    {
+        leaderDcl->setSubRegAlign(dcl->getSubRegAlign());
+    }
+
+    for (auto& use : info.uses)
+    {
+        G4_INST* useInst = use.first;
+        G4_SrcRegRegion* src = useInst->getSrc(use.second)->asSrcRegRegion();
+        G4_SrcRegRegion* newSrc = builder.createSrcRegRegion(src->getModifier(), Direct,
+            leaderDcl->getRegVar(), src->getRegOff(), src->getSubRegOff(),
+            src->getRegion(), src->getType());
+        if (src->isAccRegValid())
+        {
+            newSrc->setAccRegSel(src->getAccRegSel());
+        }
+        useInst->setSrc(newSrc, use.second);
+    }
+
+    for (auto& def : info.defs)
+    {
+        def.first->erase(def.second);
+        numInstsRemoved++;
+    }
+    info.defs.clear();
+    info.uses.clear();
+}
+
+void GVN::doGVN()
+{
+    if (hasUnsupportedCF())
+    {
+        return;
+    }
+
+    computeDominators();
+    computeLoops();
+    collectDefsAndUses();
+
+    // Visit values so that a leader is always seen before the values
+    // it dominates.
+    std::vector<DclInfo*> candidates;
+    for (auto& item : dclInfo)
+    {
+        DclInfo& info = item.second;
+        if (info.candidate && info.bb && idom[info.bb->getId()])
+        {
+            candidates.push_back(&info);
+        }
+    }
+    if (candidates.size() < 2)
+    {
+        return;
+    }
+    std::sort(candidates.begin(), candidates.end(),
+        [this](DclInfo* info1, DclInfo* info2)
+    {
+        unsigned rpo1 = rpoNum[info1->bb->getId()];
+        unsigned rpo2 = rpoNum[info2->bb->getId()];
+        if (rpo1 != rpo2)
+            return rpo1 < rpo2;
+        return info1->firstPos < info2->firstPos;
+    });
+
+    // Open addressing table of leaders, linear probing.
+    unsigned tableSize = 16;
+    while (tableSize < candidates.size() * 2)
+    {
+        tableSize <<= 1;
+    }
+    const unsigned mask = tableSize - 1;
+    DclInfo** table = (DclInfo**)mem.alloc(sizeof(DclInfo*) * tableSize);
+    memset(table, 0, sizeof(DclInfo*) * tableSize);
+
+    for (auto info : candidates)
+    {
+        // Evaluated here rather than upfront since sources may have been
+        // renamed to their own leader in the meantime.
+        if (!isValidCandidate(*info))
+        {
+            continue;
+        }
+        info->hash = hashDefs(*info);
+
+        unsigned idx = (unsigned)info->hash & mask;
+        DclInfo* leader = nullptr;
+        while (table[idx])
+        {
+            if (table[idx]->hash == info->hash && canReplace(*table[idx], *info))
+            {
+                leader = table[idx];
+                break;
+            }
+            idx = (idx + 1) & mask;
+        }
+
+        if (leader)
+        {
+            replaceDcl(*leader, *info);
+        }
+        else
+        {
+            table[idx] = info;
+        }
+    }
+}
@@ -0,0 +1,112 @@
+/*===================== begin_copyright_notice ==================================
+
+Copyright (c) 2017 Intel Corporation
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+======================= end_copyright_notice ==================================*/
+#ifndef _G4_GVN_H_
+#define _G4_GVN_H_
+
+#include "Optimizer.h"
+#include <unordered_map>
+#include <vector>
+
+namespace vISA
+{
+// GVN removes virtual variables that hold the same value as a variable
+// computed in a dominating block. Unlike LVN, which works on single
+// instructions within a BB, a value here is the whole sequence of defs
+// of a declare, e.g. a message header built by several NoMask movs or
+// an address computation. The pass is intentionally conservative:
+//  - all defs of a candidate are NoMask, unpredicated, without cond mod
+//    and sit in a single BB,
+//  - their sources are immediates or variables whose every def happens
+//    before the first def of the leader and outside of any loop,
+// so that the leader and the candidate are guaranteed to hold the same
+// bits on every channel wherever the candidate is read.
+class GVN
+{
+private:
+    // Everything known about the defs of a root declare.
+    struct DclInfo
+    {
+        G4_Declare* dcl = nullptr;
+        // BB holding all defs, nullptr if defs span several BBs.
+        G4_BB* bb = nullptr;
+        // Position of the first/last def within bb.
+        unsigned firstPos = 0;
+        unsigned lastPos = 0;
+        // Some def is in a BB that is part of a cycle.
+        bool defInLoop = false;
+        // Declare may be replaced by/replace an equivalent declare.
+        bool candidate = true;
+        uint64_t hash = 0;
+        std::vector<std::pair<G4_BB*, INST_LIST_ITER>> defs;
+        // Instructions reading the declare and the src index read.
+        std::vector<std::pair<G4_INST*, unsigned>> uses;
+    };
+
+    G4_Kernel& kernel;
+    FlowGraph& fg;
+    IR_Builder& builder;
+    vISA::Mem_Manager& mem;
+    unsigned int numInstsRemoved = 0;
+
+    std::unordered_map<G4_Declare*, DclInfo> dclInfo;
+    // Position of every instruction within its BB.
+    std::unordered_map<G4_INST*, unsigned> instPos;
+    std::vector<G4_BB*> idom;
+    std::vector<unsigned> rpoNum;
+    std::vector<bool> inLoop;
+    std::vector<G4_BB*> rpo;
+
+    // Candidates bigger than this are not worth extending the live
+    // range of their leader.
+    static const unsigned MaxGVNDefs = 8;
+    static const unsigned MaxGVNRows = 2;
+
+    bool hasUnsupportedCF();
+    void computeDominators();
+    void computeLoops();
+    bool dominates(G4_BB* bb1, G4_BB* bb2);
+    bool isBefore(G4_BB* bb1, unsigned pos1, G4_BB* bb2, unsigned pos2);
+    void collectDefsAndUses();
+    bool isCandidateInst(G4_INST* inst);
+    bool isInvariantSrc(G4_Operand* src, DclInfo& user);
+    bool isValidCandidate(DclInfo& info);
+    uint64_t hashDefs(DclInfo& info);
+    bool defsMatch(DclInfo& info1, DclInfo& info2);
+    bool srcsMatch(G4_Operand* src1, G4_Operand* src2);
+    bool canReplace(DclInfo& leader, DclInfo& info);
+    void replaceDcl(DclInfo& leader, DclInfo& info);
+
+public:
+    GVN(G4_Kernel& k, IR_Builder& irBuilder, vISA::Mem_Manager& mmgr) :
+        kernel(k), fg(k.fg), builder(irBuilder), mem(mmgr)
+    {
+    }
+
+    void doGVN();
+    unsigned int getNumInstsRemoved() { return numInstsRemoved; }
+};
+}
+#endif
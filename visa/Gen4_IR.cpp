@@ -785,7 +785,7 @@ G4_INST::G4_INST(const IR_Builder& irb,
     G4_Operand* s0,
     G4_Operand* s1,
     unsigned int opt) :
-    op(o), dst(d), predicate(prd), mod(m), option(opt),
+    op(o), option(opt), dst(d), predicate(prd), mod(m),
     useInstList(irb.getAllocator()),
     defInstList(irb.getAllocator()),
     local_id(0),
@@ -828,7 +828,7 @@ G4_INST::G4_INST(const IR_Builder& irb,
     G4_Operand* s1,
     G4_Operand* s2,
     unsigned int opt) :
-    op(o), dst(d), predicate(prd), mod(m), option(opt),
+    op(o), option(opt), dst(d), predicate(prd), mod(m),
     useInstList(irb.getAllocator()),
     defInstList(irb.getAllocator()),
     local_id(0),
@@ -1528,19 +1528,19 @@ void G4_INST::addDefUse(G4_INST* inst, Gen4_Operand_Number srcPos)
 }
 
 // exchange def/use info of src0 and src1 after they are swapped.
-void G4_INST::swapDefUse()
+void G4_INST::swapDefUse(Gen4_Operand_Number srcIxA, Gen4_Operand_Number srcIxB)
 {
     DEF_EDGE_LIST_ITER iter = this->defInstList.begin();
     // since ACC is only exposed in ARCTAN intrinsic translation, there is no instruction split with ACC
     while (iter != this->defInstList.end())
     {
-        if ((*iter).second == Opnd_src1)
+        if ((*iter).second == srcIxB)
         {
-            (*iter).second = Opnd_src0;
+            (*iter).second = srcIxA;
         }
-        else if ((*iter).second == Opnd_src0)
+        else if ((*iter).second == srcIxA)
         {
-            (*iter).second = Opnd_src1;
+            (*iter).second = srcIxB;
         }
         else
         {
@@ -1553,13 +1553,13 @@ void G4_INST::swapDefUse()
         {
             if ((*useIter).first == this)
             {
-                if ((*useIter).second == Opnd_src1)
+                if ((*useIter).second == srcIxB)
                 {
-                    (*useIter).second = Opnd_src0;
+                    (*useIter).second = srcIxA;
                 }
-                else if ((*useIter).second == Opnd_src0)
+                else if ((*useIter).second == srcIxA)
                 {
-                    (*useIter).second = Opnd_src1;
+                    (*useIter).second = srcIxB;
                 }
             }
         }
@@ -8255,3 +8255,26 @@ G4_INST* G4_InstMath::cloneInst()
         src0, src1, getMathCtrl(), option, getLineNo(), getCISAOff(), getSrcFilename());
 }
 
+G4_INST* G4_InstSend::cloneInst()
+{
+    auto nonConstBuilder = const_cast<IR_Builder*>(&builder);
+    auto prd = nonConstBuilder->duplicateOperand(getPredicate());
+    auto dst = nonConstBuilder->duplicateOperand(getDst());
+    auto payload = nonConstBuilder->duplicateOperand(getSrc(0))->asSrcRegRegion();
+    // Give the clone its own descriptor, it may be updated independently.
+    auto md = new (nonConstBuilder->mem) G4_SendMsgDescriptor(*getMsgDesc());
+
+    if (isSplitSend())
+    {
+        auto src1 = nonConstBuilder->duplicateOperand(getSrc(1))->asSrcRegRegion();
+        auto desc = nonConstBuilder->duplicateOperand(getSrc(2));
+        auto extDesc = nonConstBuilder->duplicateOperand(getSrc(3));
+        return nonConstBuilder->createInternalSplitSendInst(prd, op, getExecSize(), dst,
+            payload, src1, desc, option, md, extDesc, getLineNo(), getCISAOff(), getSrcFilename());
+    }
+
+    auto desc = nonConstBuilder->duplicateOperand(getSrc(1));
+    return nonConstBuilder->createInternalSendInst(prd, op, getExecSize(), dst,
+        payload, desc, option, md, getLineNo(), getCISAOff(), getSrcFilename());
+}
+
@@ -113,11 +113,15 @@ namespace vISA
             return t;
         }
 
-        void deallocate(void* p, size_type)
+        void deallocate(void* p, size_type n)
         {
-            //No deallocation for arena allocator.
+            // Arena memory is released with the arena; small blocks
+            // (e.g. list nodes) are recycled by the next allocation.
+            mem_manager_ptr->free(p, n * sizeof(T));
         }
 
+        const Mem_Manager* getMemManager() const { return mem_manager_ptr.get(); }
+
         pointer           address(reference x) const { return &x; }
         const_pointer     address(const_reference x) const { return &x; }
 
@@ -134,7 +138,8 @@ namespace vISA
 
         size_type         max_size() const { return size_t(-1); }
 
-        bool operator==(const std_arena_based_allocator &) const { return true; }
+        // Memory may only be given back to the manager it came from.
+        bool operator==(const std_arena_based_allocator & a) const { return mem_manager_ptr == a.mem_manager_ptr; }
 
         bool operator!=(const std_arena_based_allocator & a) const { return !operator==(a); }
     };
@@ -522,12 +527,15 @@ class G4_INST
     friend class IR_Builder;
 
 protected:
+    // Fields are grouped by size to keep padding out of G4_INST, which is
+    // the most numerous IR object. Please keep it that way when adding new
+    // fields (-memstats reports the per-class footprint).
     G4_opcode        op;
+    unsigned int     option;     // inst option
     G4_Operand*      srcs[G4_MAX_SRCS];
     G4_DstRegRegion* dst;
     G4_Predicate*    predicate;
     G4_CondMod*      mod;
-    unsigned int     option;     // inst option
     G4_Operand*             implAccSrc;
     G4_DstRegRegion*        implAccDst;
 
@@ -558,11 +566,12 @@ protected:
     unsigned short evenlySplitInst : 1;
     unsigned char    execSize;
 
+    uint32_t global_id = (uint32_t) -1;
+
     BinInst *bin;
 
     // make it private so only the IR_Builder can create new instructions
     void *operator new(size_t sz, Mem_Manager& m){ return m.alloc(sz); }
-    uint32_t global_id = (uint32_t) -1;
 
     const IR_Builder& builder;  // link to builder to access the various compilation options
 
@@ -578,8 +587,8 @@ public:
 
 protected:
     int ALUID = -1;
-    unsigned char depDistance = 0;
     unsigned short SBToken = -1;
+    unsigned char depDistance = 0;
     bool operandTypeIndicated = true;
 
     struct DepToken {
@@ -1014,7 +1023,7 @@ public:
     void copyUsesTo(G4_INST *inst2, bool checked);
     void removeUseOfInst( );
     void trimDefInstList();
-    void swapDefUse();
+    void swapDefUse(Gen4_Operand_Number srcIxA = Opnd_src0, Gen4_Operand_Number srcIxB = Opnd_src1);
     void addDefUse(G4_INST* use, Gen4_Operand_Number usePos);
     void uniqueDefUse()
     {
@@ -1403,6 +1412,8 @@ public:
 
     bool isDirectSplittableSend();
 
+    G4_INST* cloneInst() override;
+
     void computeRightBound(G4_Operand* opnd) override;
 
     void emit_send(std::ostream& output, bool symbol_dst, bool *symbol_srcs);
@@ -1686,10 +1697,12 @@ class G4_Declare
     uint16_t isPartialDcl : 1;
     uint16_t refInSend : 1;
 
+    // packed with the flags above
+    uint16_t numFlagElements;
+
     unsigned int   decl_id;     // global decl id for this builder
 
     uint32_t numElements;
-    unsigned int numFlagElements;
 
     // byte offset of this declare from the base declare.  For top-level declares this value is 0
     int offsetFromBase;
@@ -2009,7 +2022,7 @@ class G4_Operand
     friend class G4_SpillIntrinsic;
 
 public:
-    enum Kind {
+    enum Kind : unsigned char {
         immediate,
         srcRegRegion,
         dstRegRegion,
@@ -2021,6 +2034,7 @@ public:
     virtual ~G4_Operand() {}
 protected:
     Kind kind;
+    bool rightBoundSet;
     G4_Type type;
     G4_INST *inst;
 
@@ -2030,7 +2044,6 @@ protected:
 
     uint64_t bitVec[2];  // bit masks at byte granularity (for flags, at bit granularity)
 
-    bool rightBoundSet;
     unsigned byteOffset;
     G4_AccRegSel accRegSel;
 
@@ -2050,16 +2063,16 @@ protected:
 
     explicit G4_Operand(Kind k, G4_Type ty = Type_UNDEF,
                         G4_VarBase *base = nullptr)
-        : kind(k), type(ty), inst(nullptr), top_dcl(nullptr), base(base),
-          rightBoundSet(false), byteOffset(0), accRegSel(ACC_UNDEFINED),
+        : kind(k), rightBoundSet(false), type(ty), inst(nullptr), top_dcl(nullptr), base(base),
+          byteOffset(0), accRegSel(ACC_UNDEFINED),
           left_bound(0), right_bound(0)
     {
         bitVec[0] = bitVec[1] = 0;
     }
 
     G4_Operand(Kind k, G4_VarBase *base)
-        : kind(k), type(Type_UNDEF), inst(nullptr), top_dcl(nullptr), base(base),
-          rightBoundSet(false), byteOffset(0), accRegSel(ACC_UNDEFINED),
+        : kind(k), rightBoundSet(false), type(Type_UNDEF), inst(nullptr), top_dcl(nullptr), base(base),
+          byteOffset(0), accRegSel(ACC_UNDEFINED),
           left_bound(0), right_bound(0)
     {
         bitVec[0] = bitVec[1] = 0;
@@ -99,6 +99,8 @@ static const unsigned IN_LOOP_REFERENCE_COUNT_FACTOR = 4;
 #define BANK_CONFLICT_SIMD8_OVERHEAD_CYCLE     1
 #define BANK_CONFLICT_SIMD16_OVERHEAD_CYCLE    2
 #define INTERNAL_CONFLICT_RATIO_HEURISTIC 0.25
+#define BUNDLE_CONFLICT_MAX_DCLS          16
+#define BUNDLE_GRF_ROWS                   4 //consecutive GRFs of a bundle, see GlobalRA::get_bundle()
 
 
 Interference::Interference(LivenessAnalysis* l, LiveRange**& lr, unsigned n, unsigned ns, unsigned nm,
@@ -809,6 +811,73 @@ void BankConflictPass::setupBankConflictsforTwoGRFs(G4_INST* inst)
 }
 
 
+//
+// Record the other GRF sources of a three source instruction as bundle
+// conflict siblings of each source. These are soft constraints: color
+// selection avoids the bundles already taken by assigned siblings but
+// falls back to any register rather than spilling.
+//
+// Color selection checks the bundle of the base register of a declare, so a
+// sibling is only recorded for a source whose row is a whole number of
+// bundles away from its base. The bundle of that row then follows from the
+// bundle of the base, and the sibling's bundle is taken at its own row.
+//
+void BankConflictPass::setupBundleConflictsForInst(G4_INST* inst)
+{
+    G4_Declare* dcls[3] = { nullptr, nullptr, nullptr };
+    int offset[3] = { 0, 0, 0 };
+
+    for (int i = 0; i < 3; i++)
+    {
+        G4_Operand* src = inst->getSrc(i);
+        if (!src || !src->isSrcRegRegion() || src->isAccReg() ||
+            src->asSrcRegRegion()->isIndirect())
+        {
+            continue;
+        }
+
+        G4_Declare* dcl = GetTopDclFromRegRegion(src);
+        if (!dcl || !(dcl->getRegFile() & (G4_GRF | G4_INPUT)))
+        {
+            continue;
+        }
+        G4_Declare* opndDcl = src->getBase()->asRegVar()->getDeclare();
+
+        dcls[i] = dcl;
+        offset[i] = (opndDcl->getOffsetFromBase() + src->getLeftBound()) / G4_GRF_REG_NBYTES;
+    }
+
+    for (int i = 0; i < 3; i++)
+    {
+        if (!dcls[i] || dcls[i]->getRegFile() != G4_GRF)
+        {
+            continue;
+        }
+
+        if (offset[i] % BUNDLE_GRF_ROWS != 0)
+        {
+            continue;
+        }
+
+        for (int j = 0; j < 3; j++)
+        {
+            if (i == j || !dcls[j] || dcls[j] == dcls[i])
+            {
+                continue;
+            }
+
+            // Row of the sibling, shifted by as many whole bundles as the
+            // row of dcls[i] is from its base register.
+            int relOffset = offset[j] - offset[i];
+            if (gra.getBundleConflictDclSize(dcls[i]) < BUNDLE_CONFLICT_MAX_DCLS &&
+                !gra.hasBundleConflictDcl(dcls[i], dcls[j], relOffset))
+            {
+                gra.addBundleConflictDcl(dcls[i], dcls[j], relOffset);
+            }
+        }
+    }
+}
+
 void BankConflictPass::setupBankConflictsForBB(G4_BB* bb,
     unsigned int &threeSourceInstNum,
     unsigned int &sendInstNum,
@@ -842,6 +911,14 @@ void BankConflictPass::setupBankConflictsForBB(G4_BB* bb,
                     setupBankConflictsforTwoGRFs(inst);
             }
 
+            // Conflicts only cost repeatedly in loops, keep the color
+            // choices elsewhere free.
+            if (bb->getNestLevel() > 0 &&
+                gra.kernel.fg.builder->hasRegisterBundles() &&
+                gra.kernel.getOption(vISA_BundleConflictReduction))
+            {
+                setupBundleConflictsForInst(inst);
+            }
         }
         if (inst->isSend() && !inst->isEOT())
         {
@@ -6549,6 +6626,23 @@ void GraphColor::addCallerSaveRestoreCode()
                     }
                 }
             }
+
+            // Registers the callee is known to leave intact need no saving.
+            if (m_options->getOption(vISA_IPACallerSave) &&
+                !callInst->asCFInst()->isIndirectCall())
+            {
+                G4_Kernel* callee = builder.kernel.getCompilationUnit(callInst->asCFInst()->getCallee());
+                auto calleeClobbers = callee ? callee->getCallerSaveClobbers() : nullptr;
+                for (unsigned j = 0; calleeClobbers && j < callerSaveNumGRF; j++)
+                {
+                    if (callerSaveRegs[j] && !(*calleeClobbers)[j])
+                    {
+                        callerSaveRegs[j] = false;
+                        callerSaveRegCount--;
+                    }
+                }
+            }
+
             OptimizeActiveRegsFootprint(callerSaveRegs, retRegs);
 
             unsigned callerSaveRegsWritten = 0;
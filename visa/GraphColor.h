@@ -61,6 +61,7 @@ namespace vISA
         unsigned int numRegLRA, unsigned int & internalConflict);
         bool hasInternalConflict3Srcs(BankConflict *srcBC);
         void setupBankForSrc0(G4_INST* inst, G4_INST* prevInst);
+        void setupBundleConflictsForInst(G4_INST* inst);
         void getBanks(G4_INST* inst, BankConflict *srcBC, G4_Declare **dcls, G4_Declare **opndDcls, unsigned int *offset);
         void getPrevBanks(G4_INST* inst, BankConflict *srcBC, G4_Declare **dcls, G4_Declare **opndDcls, unsigned int *offset);
 
@@ -1052,6 +1053,21 @@ namespace vISA
             return (unsigned)(vars[dclid].bundleConflictDcls.size());
         }
 
+        bool hasBundleConflictDcl(G4_Declare* dcl, G4_Declare* subDcl, int offset)
+        {
+            auto dclid = dcl->getDeclId();
+            resize(dclid);
+            for (size_t i = 0, e = vars[dclid].bundleConflictDcls.size(); i < e; i++)
+            {
+                if (vars[dclid].bundleConflictDcls[i] == subDcl &&
+                    vars[dclid].bundleConflictoffsets[i] == offset)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
         unsigned int get_bundle(unsigned int baseReg, int offset)
         {
             return (((baseReg + offset) % 64) / 4);
@@ -805,6 +805,12 @@ bool LocalRA::assignUniqueRegisters(bool twoBanksRA, bool twoDirectionsAssign)
 
                 nrows = phyRegMgr.findFreeRegs(sizeInWords, (bankAlign != BankAlign::Either) ? bankAlign : align,
                     subAlign, regNum, subregNum, 0, numRegLRA - 1, occupiedBundles, 0, false);
+                if (!nrows && occupiedBundles)
+                {
+                    // Bundle conflicts are soft constraints
+                    nrows = phyRegMgr.findFreeRegs(sizeInWords, (bankAlign != BankAlign::Either) ? bankAlign : align,
+                        subAlign, regNum, subregNum, 0, numRegLRA - 1, 0, 0, false);
+                }
             }
             else
             {
@@ -2718,6 +2724,27 @@ bool LinearScan::allocateRegs(LocalLiveRange* lr, G4_BB* bb, IR_Builder& builder
         }
     }
 
+    // Bundle conflicts are soft constraints, retry ignoring them before
+    // spilling anything.
+    if (!nrows && occupiedBundles)
+    {
+        nrows = pregManager.findFreeRegs(size,
+            bankAlign,
+            subalign,
+            regnum,
+            subregnum,
+            0,
+            localRABound,
+            0,
+            instID,
+            false);
+
+        if (nrows && useRoundRobin)
+        {
+            *startGRFReg = (regnum + nrows) % (localRABound);
+        }
+    }
+
     // If allocations fails, return false
     if (!nrows)
     {
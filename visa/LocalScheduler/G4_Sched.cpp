@@ -12,6 +12,7 @@ static const unsigned PRESSURE_REDUCTION_MIN_BENEFIT = 5;
 static const unsigned PRESSURE_REDUCTION_THRESHOLD = 110;
 static const unsigned PRESSURE_REDUCTION_THRESHOLD_SIMD32 = 120;
 static const unsigned LATENCY_PRESSURE_THRESHOLD = 100;
+static const unsigned LATENCY_MAX_BACKTRACKS = 2;
 
 namespace {
 
@@ -308,9 +309,9 @@ struct RegisterPressure
 
     ~RegisterPressure()
     {
-        // Delete only if owns the following objects.
-        if (p2a) {
-            delete p2a;
+        // Delete only if owns the following objects. Points-to analysis is
+        // owned by the kernel.
+        if (gra) {
             delete gra;
             delete liveness;
             delete rpe;
@@ -322,8 +323,7 @@ struct RegisterPressure
 
     void init()
     {
-        p2a = new PointsToAnalysis(kernel.Declares, kernel.fg.getNumBB());
-        p2a->doPointsToAnalysis(kernel.fg);
+        p2a = &kernel.getPointsToAnalysis();
         gra = new GlobalRA(kernel, kernel.fg.builder->phyregpool, *p2a);
         // To properly track liveness for partially-written local variables.
         gra->markGraphBlockLocalVars();
@@ -451,6 +451,10 @@ class BB_Scheduler {
 
     const LatencyTable &LT;
 
+    // The max pressure of the last evaluated schedule, 0 if the schedule
+    // was not evaluated.
+    unsigned LastRPE = 0;
+
 public:
     BB_Scheduler(G4_Kernel& kernel, preDDD& ddd, RegisterPressure& rp,
         SchedConfig config, const LatencyTable& LT)
@@ -470,14 +474,19 @@ public:
 
     // Run list scheduling.
     void scheduleBlockForPressure() { SethiUllmanScheduling(); }
-    void scheduleBlockForLatency() { LatencyScheduling(); }
+    void scheduleBlockForLatency(unsigned GroupThreshold)
+    {
+        LatencyScheduling(GroupThreshold);
+    }
 
     // Commit this scheduling if it reduces register pressure.
     bool commitIfBeneficial(unsigned &MaxRPE, bool IsTopDown);
 
+    unsigned getLastPressure() const { return LastRPE; }
+
 private:
     void SethiUllmanScheduling();
-    void LatencyScheduling();
+    void LatencyScheduling(unsigned GroupThreshold);
     bool verifyScheduling();
 
     // Relocate pseudo-kills right before its successors.
@@ -596,13 +605,34 @@ bool preRA_Scheduler::run()
         };
 
         if (tryLatencyHiding()) {
-            ddd.reset(Changed);
-            S.scheduleBlockForLatency();
-            if (S.commitIfBeneficial(MaxPressure, /*IsTopDown*/ true)) {
-                SCHED_DUMP(rp.dump(bb, "After scheduling for latency, "));
-                Changed = true;
-                kernel.fg.builder->getcompilerStats().SetFlag("PreRASchedulerForLatency",
-                                                              this->kernel.getSimdSize());
+            // Instructions are grouped for latency as long as the estimated
+            // pressure of a group stays under the threshold. The estimate
+            // is optimistic; when the resulting schedule crosses the
+            // threshold, backtrack and regroup with the budget lowered by
+            // the overshoot, hiding less latency rather than spilling.
+            unsigned LatencyThreshold = getLatencyHidingThreshold(kernel);
+            unsigned GroupThreshold = LatencyThreshold;
+            for (unsigned Attempt = 0; Attempt <= LATENCY_MAX_BACKTRACKS; ++Attempt) {
+                ddd.reset(Changed);
+                S.scheduleBlockForLatency(GroupThreshold);
+                if (S.commitIfBeneficial(MaxPressure, /*IsTopDown*/ true)) {
+                    SCHED_DUMP(rp.dump(bb, "After scheduling for latency, "));
+                    Changed = true;
+                    kernel.fg.builder->getcompilerStats().SetFlag("PreRASchedulerForLatency",
+                                                                  this->kernel.getSimdSize());
+                    break;
+                }
+
+                // Not reverted for pressure, nothing to retry.
+                unsigned NewRPE = S.getLastPressure();
+                if (NewRPE <= LatencyThreshold)
+                    break;
+                unsigned Overshoot = NewRPE - LatencyThreshold;
+                if (Overshoot >= GroupThreshold)
+                    break;
+                GroupThreshold -= Overshoot;
+                SCHED_DUMP(std::cerr << "backtrack with group threshold "
+                                     << GroupThreshold << "\n");
             }
         }
     }
@@ -1079,11 +1109,15 @@ class LatencyQueue : public QueueBase {
     // Instrction latency information.
     const LatencyTable &LT;
 
+    // The pressure budget of a group of instructions.
+    unsigned GroupThreshold;
+
 public:
     LatencyQueue(preDDD& ddd, RegisterPressure& rp, SchedConfig config,
-        const LatencyTable& LT)
+        const LatencyTable& LT, unsigned GroupThreshold)
         : QueueBase(ddd, rp, config)
         , LT(LT)
+        , GroupThreshold(GroupThreshold)
     {
         init();
     }
@@ -1132,10 +1166,10 @@ private:
 
 // Scheduling block to hide latency (top down).
 //
-void BB_Scheduler::LatencyScheduling()
+void BB_Scheduler::LatencyScheduling(unsigned GroupThreshold)
 {
     schedule.clear();
-    LatencyQueue Q(ddd, rp, config, LT);
+    LatencyQueue Q(ddd, rp, config, LT, GroupThreshold);
     Q.push(ddd.getEntryNode());
 
     while (!Q.empty()) {
@@ -1292,8 +1326,7 @@ void LatencyQueue::init()
         // and starts a new group.
         //
         std::vector<unsigned> Segments;
-        unsigned Threshold = getLatencyHidingThreshold(ddd.getKernel());
-        mergeSegments(RPtrace, Max, Min, Segments, Threshold);
+        mergeSegments(RPtrace, Max, Min, Segments, GroupThreshold);
 
         // Iterate segments and assign a group id to each insstruction.
         unsigned i = 0;
@@ -1525,6 +1558,7 @@ void BB_Scheduler::relocatePseudoKills()
 // Commit this scheduling if it is better.
 bool BB_Scheduler::commitIfBeneficial(unsigned& MaxRPE, bool IsTopDown)
 {
+    LastRPE = 0;
     INST_LIST& CurInsts = getBB()->getInstList();
     if (schedule.size() != CurInsts.size()) {
         SCHED_DUMP(std::cerr << "schedule reverted due to mischeduling.\n\n");
@@ -1541,7 +1575,9 @@ bool BB_Scheduler::commitIfBeneficial(unsigned& MaxRPE, bool IsTopDown)
     }
 
     // Note that list::swap does not work for some reason, but list::splice works.
-    INST_LIST TempInsts;
+    // Nodes spliced in must come from the same allocator, as they are given
+    // back to it when TempInsts is destroyed.
+    INST_LIST TempInsts(CurInsts.get_allocator());
     TempInsts.splice(TempInsts.begin(), CurInsts, CurInsts.begin(), CurInsts.end());
     assert(CurInsts.empty());
 
@@ -1555,6 +1591,7 @@ bool BB_Scheduler::commitIfBeneficial(unsigned& MaxRPE, bool IsTopDown)
 
     rp.recompute(getBB());
     unsigned NewRPE = rp.getPressure(getBB());
+    LastRPE = NewRPE;
     unsigned LatencyPressureThreshold = getLatencyHidingThreshold(kernel);
     if (config.UseLatency && IsTopDown) {
         // For hiding latency.
@@ -1592,6 +1629,10 @@ bool BB_Scheduler::commitIfBeneficial(unsigned& MaxRPE, bool IsTopDown)
     SCHED_DUMP(rp.dump(getBB(), "schedule reverted, "));
     CurInsts.clear();
     CurInsts.splice(CurInsts.begin(), TempInsts, TempInsts.begin(), TempInsts.end());
+
+    // Keep the per-instruction pressure in sync with the restored order,
+    // it drives the next scheduling attempt on this block.
+    rp.recompute(getBB());
     return false;
 }
 
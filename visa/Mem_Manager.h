@@ -45,6 +45,19 @@ namespace vISA
             return _arenaManager.AllocDataSpace(size);
         }
 
+        // Only needed for memory that is recycled while the manager is
+        // alive (e.g. nodes of containers using std_arena_based_allocator).
+        void free(void* p, size_t size)
+        {
+            _arenaManager.FreeDataSpace(p, size);
+        }
+
+        // Return the arenas kept for reuse by the calling thread to the system.
+        static void releaseArenaCache() { ArenaManager::ReleaseArenaCache(); }
+
+        size_t getAllocatedBytes() const { return _arenaManager.GetAllocatedBytes(); }
+        size_t getUsedBytes() const { return _arenaManager.GetUsedBytes(); }
+
     private:
 
         vISA::ArenaManager _arenaManager;
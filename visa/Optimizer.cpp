@@ -27,11 +27,15 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Optimizer.h"
 #include <fstream>
 #include <sstream>
+#include <iomanip>
 #include "G4_Opcode.h"
 #include "Timer.h"
 #include "G4Verifier.h"
 #include <map>
+#include <set>
 #include "LVN.h"
+#include "GVN.h"
+#include "SWPipeliner.h"
 #include "ifcvt.h"
 #include <random>
 #include <chrono>
@@ -56,8 +60,7 @@ void Optimizer::LVN()
     // conformity or due to VISA lowering.
     int numInstsRemoved = 0;
     Mem_Manager mem(1024);
-    PointsToAnalysis p(kernel.Declares, kernel.fg.getNumBB());
-    p.doPointsToAnalysis(kernel.fg);
+    PointsToAnalysis& p = kernel.getPointsToAnalysis();
     for (auto bb : kernel.fg)
     {
         ::LVN lvn(fg, bb, mem, *fg.builder, p);
@@ -77,6 +80,43 @@ void Optimizer::LVN()
     }
 }
 
+void Optimizer::GVN()
+{
+    // Remove values recomputed in blocks dominated by an identical
+    // computation. Mostly catches message headers and address
+    // computations that VISA lowering emits at every use and that the
+    // block-local LVN cannot see.
+    Mem_Manager mem(1024);
+    ::GVN gvn(kernel, builder, mem);
+    gvn.doGVN();
+
+    if (kernel.getOption(vISA_OptReport))
+    {
+        std::ofstream optreport;
+        getOptReportStream(optreport, kernel.getOptions());
+        optreport << "===== GVN =====" << std::endl;
+        optreport << "Number of instructions removed: " << gvn.getNumInstsRemoved() << std::endl << std::endl;
+        closeOptReportStream(optreport);
+    }
+}
+
+void Optimizer::swPipelining()
+{
+    // Issue the loads of the next iteration of single block loops at the
+    // bottom of the current one, so their latency overlaps the back edge.
+    SWPipeliner swp(kernel, builder);
+    swp.doSWPipelining();
+
+    if (kernel.getOption(vISA_OptReport))
+    {
+        std::ofstream optreport;
+        getOptReportStream(optreport, kernel.getOptions());
+        optreport << "===== SWPipelining =====" << std::endl;
+        optreport << "Number of sends pipelined: " << swp.getNumPipelined() << std::endl << std::endl;
+        closeOptReportStream(optreport);
+    }
+}
+
 // helper functions
 
 static int getDstSubReg( G4_DstRegRegion *dst )
@@ -521,6 +561,9 @@ void Optimizer::runPass(PassIndex Index)
     if (PI.Option != vISA_EnableAlways && !builder.getOption(PI.Option))
         return;
 
+    if (!PI.Selected)
+        return;
+
     std::string Name = PI.Name;
 
     if (builder.getOption(vISA_DumpDotAll))
@@ -529,9 +572,13 @@ void Optimizer::runPass(PassIndex Index)
     if (PI.Timer != TIMER_NUM_TIMERS)
         startTimer(PI.Timer);
 
+    kernel.computeAnalyses(PI.Requires);
+
     // Execute pass.
     (this->*(PI.Pass))();
 
+    kernel.invalidateAnalyses(~PI.Preserves);
+
     if (PI.Timer != TIMER_NUM_TIMERS)
         stopTimer(PI.Timer);
 
@@ -573,6 +620,7 @@ void Optimizer::initOptimizations()
     INITIALIZE_PASS(regAlloc,                vISA_EnableAlways,            TIMER_TOTAL_RA);
     INITIALIZE_PASS(removeLifetimeOps,       vISA_EnableAlways,            TIMER_MISC_OPTS);
     INITIALIZE_PASS(countBankConflicts,      vISA_OptReport,               TIMER_MISC_OPTS);
+    INITIALIZE_PASS(swapSrcsForBC,           vISA_SwapSrcsForBC,           TIMER_MISC_OPTS);
     INITIALIZE_PASS(removeRedundMov,         vISA_EnableAlways,            TIMER_MISC_OPTS);
     INITIALIZE_PASS(removeEmptyBlocks,       vISA_EnableAlways,            TIMER_MISC_OPTS);
     INITIALIZE_PASS(insertFallThroughJump,   vISA_EnableAlways,            TIMER_MISC_OPTS);
@@ -590,7 +638,9 @@ void Optimizer::initOptimizations()
     INITIALIZE_PASS(mergeScalarInst,         vISA_MergeScalar,             TIMER_OPTIMIZER);
     INITIALIZE_PASS(lowerMadSequence,        vISA_EnableMACOpt,            TIMER_OPTIMIZER);
     INITIALIZE_PASS(LVN,                     vISA_LVN,                     TIMER_OPTIMIZER);
+    INITIALIZE_PASS(GVN,                     vISA_GVN,                     TIMER_OPTIMIZER);
     INITIALIZE_PASS(ifCvt,                   vISA_ifCvt,                   TIMER_OPTIMIZER);
+    INITIALIZE_PASS(swPipelining,            vISA_SWPipelining,            TIMER_OPTIMIZER);
     INITIALIZE_PASS(dumpPayload,             vISA_dumpPayload,             TIMER_MISC_OPTS);
     INITIALIZE_PASS(normalizeRegion,         vISA_EnableAlways,            TIMER_MISC_OPTS);
     INITIALIZE_PASS(checkBarrierUsage,       vISA_EnableAlways,            TIMER_MISC_OPTS);
@@ -598,6 +648,7 @@ void Optimizer::initOptimizations()
     INITIALIZE_PASS(initializePayload,       vISA_InitPayload,             TIMER_NUM_TIMERS);
     INITIALIZE_PASS(cleanupBindless,         vISA_enableCleanupBindless,   TIMER_OPTIMIZER);
     INITIALIZE_PASS(countGRFUsage,           vISA_PrintRegUsage,           TIMER_MISC_OPTS);
+    INITIALIZE_PASS(reportMemStats,          vISA_MemStats,                TIMER_MISC_OPTS);
     INITIALIZE_PASS(splitVariables,          vISA_EnableSplitVariables,    TIMER_MISC_OPTS);
     INITIALIZE_PASS(changeMoveType,          vISA_ChangeMoveType,          TIMER_MISC_OPTS);
     INITIALIZE_PASS(reRAPostSchedule,        vISA_ReRAPostSchedule,        TIMER_OPTIMIZER);
@@ -611,6 +662,52 @@ void Optimizer::initOptimizations()
     INITIALIZE_PASS(insertScratchReadBeforeEOT, vISA_clearScratchWritesBeforeEOT, TIMER_MISC_OPTS);
     INITIALIZE_PASS(mapOrphans,              vISA_EnableAlways,            TIMER_MISC_OPTS);
 
+#define INITIALIZE_PASS_ANALYSES(Name, Required, Preserved) \
+    Passes[PI_##Name].Requires = Required;                  \
+    Passes[PI_##Name].Preserves = Preserved
+
+    // Passes not listed here require no cached analysis and invalidate all
+    // of them. Only list a pass after checking that it really keeps the
+    // analyses it claims to preserve.
+    //
+    // The second argument is the mask of analyses computed before the pass
+    // runs, the third one is the mask of analyses still valid after it.
+    //
+    INITIALIZE_PASS_ANALYSES(LVN,                  ANALYSIS_POINTSTO, ANALYSIS_POINTSTO);
+    INITIALIZE_PASS_ANALYSES(GVN,                  ANALYSIS_NONE,     ANALYSIS_POINTSTO);
+    INITIALIZE_PASS_ANALYSES(split4GRFVars,        ANALYSIS_NONE,     ANALYSIS_POINTSTO);
+    INITIALIZE_PASS_ANALYSES(insertFenceBeforeEOT, ANALYSIS_NONE,     ANALYSIS_POINTSTO);
+    INITIALIZE_PASS_ANALYSES(swPipelining,         ANALYSIS_POINTSTO, ANALYSIS_POINTSTO);
+    INITIALIZE_PASS_ANALYSES(preRA_Schedule,       ANALYSIS_NONE,     ANALYSIS_POINTSTO);
+    INITIALIZE_PASS_ANALYSES(reportMemStats,       ANALYSIS_NONE,     ANALYSIS_ALL);
+    INITIALIZE_PASS_ANALYSES(countBankConflicts,   ANALYSIS_NONE,     ANALYSIS_ALL);
+    INITIALIZE_PASS_ANALYSES(countGRFUsage,        ANALYSIS_NONE,     ANALYSIS_ALL);
+
+#define INITIALIZE_PASS_OPTIONAL(Name) \
+    Passes[PI_##Name].Optional = true
+
+    // Optimizations that -passes may leave out. Passes the code generation
+    // depends on (conformity, RA, scheduling, send fusion, variable
+    // splitting, payload setup, workarounds) must not be listed here.
+    //
+    INITIALIZE_PASS_OPTIONAL(cleanMessageHeader);
+    INITIALIZE_PASS_OPTIONAL(renameRegister);
+    INITIALIZE_PASS_OPTIONAL(newLocalDefHoisting);
+    INITIALIZE_PASS_OPTIONAL(newLocalCopyPropagation);
+    INITIALIZE_PASS_OPTIONAL(cselPeepHoleOpt);
+    INITIALIZE_PASS_OPTIONAL(mergeScalarInst);
+    INITIALIZE_PASS_OPTIONAL(lowerMadSequence);
+    INITIALIZE_PASS_OPTIONAL(reassociateConst);
+    INITIALIZE_PASS_OPTIONAL(dce);
+    INITIALIZE_PASS_OPTIONAL(LVN);
+    INITIALIZE_PASS_OPTIONAL(GVN);
+    INITIALIZE_PASS_OPTIONAL(ifCvt);
+    INITIALIZE_PASS_OPTIONAL(swPipelining);
+    INITIALIZE_PASS_OPTIONAL(preRA_Schedule);
+    INITIALIZE_PASS_OPTIONAL(accSubPostSchedule);
+
+    selectPasses(builder.getOptions()->getOptionCstr(vISA_PassList));
+
     // Verify all passes are initialized.
 #ifdef _DEBUG
     for (unsigned i = 0; i < PI_NUM_PASSES; ++i)
@@ -620,6 +717,36 @@ void Optimizer::initOptimizations()
 #endif
 }
 
+void Optimizer::selectPasses(const char* passList)
+{
+    if (!passList)
+    {
+        return;
+    }
+
+    std::set<std::string> names;
+    std::stringstream ss(passList);
+    std::string name;
+    while (std::getline(ss, name, ','))
+    {
+        if (!name.empty())
+        {
+            names.insert(name);
+        }
+    }
+
+    // Only optional optimizations can be left out, all other passes stay
+    // in the pipeline.
+    for (unsigned i = 0; i < PI_NUM_PASSES; ++i)
+    {
+        PassInfo& PI = Passes[i];
+        if (PI.Optional)
+        {
+            PI.Selected = names.count(PI.Name) != 0;
+        }
+    }
+}
+
 void replaceAllSpilledRegions(G4_Kernel& kernel, G4_Declare* oldDcl, G4_Declare* newDcl)
 {
     // Iterate fg and replace all references to oldDcl with newDcl.
@@ -958,8 +1085,8 @@ void Optimizer::accSubPostSchedule()
         return;
     }
 
-    kernel.fg.resetLocalDataFlowData();
-    kernel.fg.localDataFlowAnalysis();
+    // RA does not maintain def-use, recompute it unless that was done already.
+    kernel.computeAnalyses(ANALYSIS_DEFUSE);
 
     HWConformity hwConf(builder, kernel, mem);
     for (auto bb : kernel.fg)
@@ -1090,10 +1217,16 @@ int Optimizer::optimization()
     // Local Value Numbering
     runPass(PI_LVN);
 
+    // Global Value Numbering
+    runPass(PI_GVN);
+
     runPass(PI_split4GRFVars);
 
     runPass(PI_insertFenceBeforeEOT);
 
+    // Software pipelining of single block loops
+    runPass(PI_swPipelining);
+
     // PreRA scheduling
     runPass(PI_preRA_Schedule);
 
@@ -1104,6 +1237,8 @@ int Optimizer::optimization()
         return CM_SPILL;
     }
 
+    runPass(PI_reportMemStats);
+
     runPass(PI_removeLifetimeOps);
 
     runPass(PI_countBankConflicts);
@@ -1150,6 +1285,9 @@ int Optimizer::optimization()
 
     runPass(PI_accSubPostSchedule);
 
+    // Swap mad sources to get read suppression on the final schedule
+    runPass(PI_swapSrcsForBC);
+
     // NoDD optimization
     runPass(PI_NoDD);
 
@@ -7843,6 +7981,126 @@ public:
         RELEASE_MSG("\tKernel " << kernel.getOrigCMName() << " : " << count << " registers\n");
     }
 
+    //
+    // Report the number of objects and bytes of each IR class. This is run
+    // right after RA, where the IR (including spill code) is the largest.
+    //
+    void Optimizer::reportMemStats()
+    {
+        enum IRClass
+        {
+            IC_INST, IC_InstSend, IC_InstCF, IC_InstMath, IC_InstIntrinsic,
+            IC_SrcRegRegion, IC_DstRegRegion, IC_Predicate, IC_CondMod, IC_AddrExp,
+            IC_Imm, IC_Label, IC_Declare, IC_RegVar, IC_UseDefEdge, IC_NUM
+        };
+        static const char* names[IC_NUM] =
+        {
+            "G4_INST", "G4_InstSend", "G4_InstCF", "G4_InstMath", "G4_InstIntrinsic",
+            "G4_SrcRegRegion", "G4_DstRegRegion", "G4_Predicate", "G4_CondMod", "G4_AddrExp",
+            "G4_Imm", "G4_Label", "G4_Declare", "G4_RegVar", "use/def edge"
+        };
+        // a use/def edge is a std::list node holding a USE_DEF_NODE
+        const size_t sizes[IC_NUM] =
+        {
+            sizeof(G4_INST), sizeof(G4_InstSend), sizeof(G4_InstCF), sizeof(G4_InstMath), sizeof(G4_InstIntrinsic),
+            sizeof(G4_SrcRegRegion), sizeof(G4_DstRegRegion), sizeof(G4_Predicate), sizeof(G4_CondMod), sizeof(G4_AddrExp),
+            sizeof(G4_Imm), sizeof(G4_Label), sizeof(G4_Declare), sizeof(G4_RegVar),
+            sizeof(USE_DEF_NODE) + 2 * sizeof(void*)
+        };
+        size_t counts[IC_NUM] = { 0 };
+
+        // immediates and labels are shared between instructions
+        std::set<G4_Operand*> opnds;
+        auto countOpnd = [&](G4_Operand* opnd)
+        {
+            if (!opnd || !opnds.insert(opnd).second)
+            {
+                return;
+            }
+            switch (opnd->getKind())
+            {
+            case G4_Operand::srcRegRegion: counts[IC_SrcRegRegion]++; break;
+            case G4_Operand::dstRegRegion: counts[IC_DstRegRegion]++; break;
+            case G4_Operand::predicate:    counts[IC_Predicate]++; break;
+            case G4_Operand::condMod:      counts[IC_CondMod]++; break;
+            case G4_Operand::addrExp:      counts[IC_AddrExp]++; break;
+            case G4_Operand::immediate:    counts[IC_Imm]++; break;
+            case G4_Operand::label:        counts[IC_Label]++; break;
+            }
+        };
+
+        for (auto bb : kernel.fg)
+        {
+            for (auto inst : *bb)
+            {
+                if (inst->isSend())
+                {
+                    counts[IC_InstSend]++;
+                }
+                else if (inst->isCFInst())
+                {
+                    counts[IC_InstCF]++;
+                }
+                else if (inst->isMath())
+                {
+                    counts[IC_InstMath]++;
+                }
+                else if (inst->isIntrinsic())
+                {
+                    counts[IC_InstIntrinsic]++;
+                }
+                else
+                {
+                    counts[IC_INST]++;
+                }
+
+                countOpnd(inst->getDst());
+                for (int i = 0; i < G4_MAX_SRCS; ++i)
+                {
+                    countOpnd(inst->getSrc(i));
+                }
+                countOpnd(inst->getPredicate());
+                countOpnd(inst->getCondMod());
+                countOpnd(inst->getImplAccSrc());
+                countOpnd(inst->getImplAccDst());
+
+                // each edge is recorded on both of its ends
+                counts[IC_UseDefEdge] += inst->use_size() + inst->def_size();
+            }
+        }
+
+        counts[IC_Declare] = kernel.Declares.size();
+        for (auto dcl : kernel.Declares)
+        {
+            if (dcl->getRegVar())
+            {
+                counts[IC_RegVar]++;
+            }
+        }
+
+        std::stringstream ss;
+        ss << "\tKernel " << kernel.getOrigCMName() << " memory stats:\n";
+        size_t total = 0;
+        for (int i = 0; i < IC_NUM; ++i)
+        {
+            size_t bytes = counts[i] * sizes[i];
+            total += bytes;
+            ss << "\t\t" << std::left << std::setw(18) << names[i] << std::right
+                << std::setw(10) << counts[i] << " x " << std::setw(3) << sizes[i]
+                << " = " << std::setw(10) << bytes << " bytes\n";
+        }
+        ss << "\t\ttotal IR: " << total << " bytes\n";
+        ss << "\t\tIR arena: " << builder.mem.getUsedBytes() << " used / "
+            << builder.mem.getAllocatedBytes() << " allocated bytes\n";
+        const Mem_Manager* edgeMem = builder.getAllocator().getMemManager();
+        if (edgeMem)
+        {
+            ss << "\t\tuse/def arena: " << edgeMem->getUsedBytes() << " used / "
+                << edgeMem->getAllocatedBytes() << " allocated bytes\n";
+        }
+        RELEASE_MSG(ss.str());
+    }
+
     //
     //  Dump the input payload to start of scratch space.
     //  this is strictly for debugging and we do not care if this gets overwritten by
@@ -10628,6 +10886,93 @@ void Optimizer::ifCvt()
     runIfCvt(fg);
 }
 
+//
+// A three source instruction doesn't read a GRF again if the previous
+// instruction of the same opcode read it through the same source slot.
+// The suppressed read can't take part in a bank or bundle conflict. As
+// src1 and src2 of mad are commutative, swap them after RA when that
+// turns a read of the register the previous mad read through the other
+// slot into a suppressed one.
+//
+void Optimizer::swapSrcsForBC()
+{
+    if (!builder.hasReadSuppression())
+    {
+        return;
+    }
+
+    auto getGRF = [](G4_Operand* opnd) -> int
+    {
+        if (!opnd || !opnd->isSrcRegRegion() ||
+            opnd->asSrcRegRegion()->isIndirect() || !opnd->isGreg())
+        {
+            return -1;
+        }
+        return opnd->getLinearizedStart() / GENX_GRF_REG_SIZ;
+    };
+
+    auto canSwap = [](G4_INST* inst) -> bool
+    {
+        G4_Operand* src1 = inst->getSrc(1);
+        G4_Operand* src2 = inst->getSrc(2);
+        if (!src1->isSrcRegRegion() || !src2->isSrcRegRegion() ||
+            !src1->isGreg() || !src2->isGreg())
+        {
+            return false;
+        }
+        // Keep both operands legal in the other slot.
+        return src1->getType() == src2->getType() &&
+            src1->asSrcRegRegion()->getRegion()->isEqual(
+                src2->asSrcRegRegion()->getRegion());
+    };
+
+    unsigned int numSwapped = 0;
+    unsigned int cyclesSaved = 0;
+    for (auto bb : kernel.fg)
+    {
+        G4_INST* prevInst = nullptr;
+        for (auto inst : *bb)
+        {
+            if (inst->opcode() == G4_mad && prevInst &&
+                prevInst->opcode() == G4_mad && canSwap(inst))
+            {
+                int prevSrc1 = getGRF(prevInst->getSrc(1));
+                int prevSrc2 = getGRF(prevInst->getSrc(2));
+                int src1 = getGRF(inst->getSrc(1));
+                int src2 = getGRF(inst->getSrc(2));
+                // No suppression of a register the previous mad wrote.
+                G4_DstRegRegion* prevDst = prevInst->getDst();
+                int prevDstGRF = (prevDst && !prevDst->isIndirect() && prevDst->isGreg()) ?
+                    prevDst->getLinearizedStart() / GENX_GRF_REG_SIZ : -1;
+
+                bool suppressed = src1 == prevSrc1 || src2 == prevSrc2;
+                bool suppressedIfSwapped = (src2 == prevSrc1 && src2 != prevDstGRF) ||
+                    (src1 == prevSrc2 && src1 != prevDstGRF);
+                if (!suppressed && suppressedIfSwapped)
+                {
+                    G4_Operand* tmp = inst->getSrc(1);
+                    inst->setSrc(inst->getSrc(2), 1);
+                    inst->setSrc(tmp, 2);
+                    inst->swapDefUse(Opnd_src1, Opnd_src2);
+                    numSwapped++;
+                    cyclesSaved += inst->getExecSize() > 8 ? 2 : 1;
+                }
+            }
+            prevInst = inst;
+        }
+    }
+
+    if (kernel.getOption(vISA_OptReport))
+    {
+        std::ofstream optreport;
+        getOptReportStream(optreport, kernel.getOptions());
+        optreport << "===== swapSrcsForBC =====" << std::endl;
+        optreport << "Number of mad sources swapped: " << numSwapped << std::endl;
+        optreport << "Estimated conflict cycles saved: " << cyclesSaved << std::endl << std::endl;
+        closeOptReportStream(optreport);
+    }
+}
+
 
 
 namespace {
@@ -10996,6 +11341,9 @@ void Optimizer::split4GRFVars()
         return;
     }
 
+    // split candidates get replaced by new declares
+    kernel.invalidateAnalyses(ANALYSIS_POINTSTO);
+
     // create Lo/Hi for each variable being split
     for (auto splitDcl : varToSplitOrdering)
     {
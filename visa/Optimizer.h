@@ -192,6 +192,10 @@ class Optimizer
 
     void LVN();
 
+    void GVN();
+
+    void swPipelining();
+
     void ifCvt();
 
     void ifCvtFCCall();
@@ -223,12 +227,14 @@ private:
     void cleanupBindless();
     G4_Operand* updateSendsHeaderReuse(std::vector<std::vector<G4_INST*>> &, std::vector<G4_INST*> &, INST_LIST_ITER);
     void countGRFUsage();
+    void reportMemStats();
     void splitVariables();
     void changeMoveType();
     void split4GRFVars();
 
     void countBankConflicts();
     unsigned int numBankConflicts;
+    void swapSrcsForBC();
 
     bool chkFwdOutputHazard(INST_LIST_ITER &, INST_LIST_ITER&);
     bool chkFwdOutputHazard(G4_INST*, INST_LIST_ITER);
@@ -280,12 +286,28 @@ private:
         /// timer i.e. TIMER_NUM_TIMERS, then no time will be recorded.
         TIMERS Timer;
 
+        /// Analyses (G4_AnalysisKind mask) computed on the kernel before this
+        /// pass runs, unless they are still valid.
+        unsigned Requires;
+
+        /// Analyses this pass keeps up to date. All others are invalidated
+        /// once the pass has run. Passes preserve nothing by default.
+        unsigned Preserves;
+
+        /// Whether the pass is an optimization that -passes may leave out.
+        bool Optional;
+
+        /// Whether the pass is part of the pipeline selected by -passes.
+        bool Selected;
+
         PassInfo(PassType P, const char *N, vISAOptions O,
                  TIMERS T = TIMER_NUM_TIMERS)
-            : Pass(P), Name(N), Option(O), Timer(T) {}
+            : Pass(P), Name(N), Option(O), Timer(T), Requires(ANALYSIS_NONE),
+              Preserves(ANALYSIS_NONE), Optional(false), Selected(true) {}
 
         PassInfo() : Pass(0), Name(0), Option(vISA_EnableAlways),
-            Timer(TIMER_NUM_TIMERS) {}
+            Timer(TIMER_NUM_TIMERS), Requires(ANALYSIS_NONE),
+            Preserves(ANALYSIS_NONE), Optional(false), Selected(true) {}
     };
 
     bool foldPseudoAndOr(G4_BB* bb, INST_LIST_ITER& iter);
@@ -306,6 +328,7 @@ public:
         PI_NoDD,
         PI_removeLifetimeOps,          // always
         PI_countBankConflicts,
+        PI_swapSrcsForBC,
         PI_removeRedundMov,            // always
         PI_removeEmptyBlocks,          // always
         PI_insertFallThroughJump,      // always
@@ -322,6 +345,8 @@ public:
         PI_mergeScalarInst,
         PI_lowerMadSequence,
         PI_LVN,
+        PI_GVN,
+        PI_swPipelining,
         PI_ifCvt,
         PI_normalizeRegion,            // always
         PI_dumpPayload,
@@ -330,6 +355,7 @@ public:
         PI_initializePayload,
         PI_cleanupBindless,
         PI_countGRFUsage,
+        PI_reportMemStats,
         PI_splitVariables,
         PI_changeMoveType,
         PI_reRAPostSchedule,
@@ -355,6 +381,9 @@ private:
     /// Initialize all passes during the construction.
     void initOptimizations();
 
+    /// Restrict the optional optimizations to the ones given by -passes.
+    void selectPasses(const char* passList);
+
     /// Common interface to execute a pass.
     void runPass(PassIndex Index);
 
@@ -1125,6 +1125,13 @@ bool PhyRegUsage::assignRegs(bool  highInternalConflict,
             bool success = findContiguousGRF(availableGregs, forbidden, occupiedBundles,
                 getAlignToUse(align, bankAlign), decl->getNumRows(), endGRFReg,
                 startGRFReg, i, varBasis->getCalleeSaveBias(), varBasis->getEOTSrc());
+            if (!success && occupiedBundles)
+            {
+                // Bundle conflicts are soft, prefer a conflict over a spill.
+                success = findContiguousGRF(availableGregs, forbidden, 0,
+                    getAlignToUse(align, bankAlign), decl->getNumRows(), endGRFReg,
+                    startGRFReg, i, varBasis->getCalleeSaveBias(), varBasis->getEOTSrc());
+            }
             if (success) {
                 varBasis->setPhyReg(regPool.getGreg(i), 0);
             }
@@ -0,0 +1,383 @@
+/*===================== begin_copyright_notice ==================================
+
+Copyright (c) 2017 Intel Corporation
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+======================= end_copyright_notice ==================================*/
+
+#include "SWPipeliner.h"
+#include "GraphColor.h"
+#include "RPE.h"
+
+#include <algorithm>
+
+using namespace vISA;
+
+// Return the back edge of a single block loop, or nullptr if bb is not one.
+G4_INST* SWPipeliner::getLoopBranch(G4_BB* bb)
+{
+    if (bb->empty())
+    {
+        return nullptr;
+    }
+
+    G4_INST* inst = bb->back();
+    if (inst->opcode() != G4_while || inst->isWriteEnableInst())
+    {
+        return nullptr;
+    }
+
+    G4_Predicate* pred = inst->getPredicate();
+    if (!pred || pred->getControl() != PRED_DEFAULT)
+    {
+        return nullptr;
+    }
+
+    if (std::find(bb->Succs.begin(), bb->Succs.end(), bb) == bb->Succs.end())
+    {
+        return nullptr;
+    }
+
+    // Channels reconverging inside the body were not active in the
+    // preheader and would miss the prologue load.
+    for (auto inst : *bb)
+    {
+        if (inst->opcode() == G4_join || inst->opcode() == G4_endif ||
+            inst->opcode() == G4_else)
+        {
+            return nullptr;
+        }
+    }
+
+    return inst;
+}
+
+// Return the only block entering the loop, provided it always falls or
+// jumps into it.
+G4_BB* SWPipeliner::getPreheader(G4_BB* bb)
+{
+    if (bb->Preds.size() != 2)
+    {
+        return nullptr;
+    }
+
+    G4_BB* preheader = bb->Preds.front() == bb ? bb->Preds.back() : bb->Preds.front();
+    if (preheader == bb || preheader->Succs.size() != 1)
+    {
+        return nullptr;
+    }
+
+    if (!preheader->empty() && preheader->back()->isFlowControl() &&
+        preheader->back()->opcode() != G4_jmpi)
+    {
+        return nullptr;
+    }
+
+    return preheader;
+}
+
+bool SWPipeliner::isCandidateSend(G4_INST* inst, G4_INST* whileInst)
+{
+    if (!inst->isSend() || inst->getPredicate() || inst->isWriteEnableInst() ||
+        inst->isEOT())
+    {
+        return false;
+    }
+
+    // The rotated send is predicated on the loop condition, which must cover
+    // exactly its channels.
+    if (inst->getExecSize() != whileInst->getExecSize() ||
+        inst->getMaskOffset() != whileInst->getMaskOffset())
+    {
+        return false;
+    }
+
+    G4_SendMsgDescriptor* msgDesc = inst->getMsgDesc();
+    if (msgDesc->getAccess() != SendAccess::READ_ONLY ||
+        msgDesc->ResponseLength() == 0 ||
+        msgDesc->isFence() || msgDesc->isBarrierMsg())
+    {
+        return false;
+    }
+
+    if (!msgDesc->isHDC() && !msgDesc->isSampler())
+    {
+        return false;
+    }
+
+    // Block messages ignore the channel mask, so the load issued for the
+    // iteration that never runs must stay within a bounds checked surface.
+    G4_Operand* bti = msgDesc->getBti();
+    if (msgDesc->isA64Message() || msgDesc->isSLMMessage() || msgDesc->isScratchRW() ||
+        !bti || !bti->isImm() || bti->asImm()->getInt() >= 0xF0)
+    {
+        return false;
+    }
+
+    G4_DstRegRegion* dst = inst->getDst();
+    if (!dst || dst->isNullReg() || dst->isIndirect())
+    {
+        return false;
+    }
+
+    G4_Declare* dcl = dst->getTopDcl();
+    return dcl && dcl->getRegFile() == G4_GRF && !dcl->getAddressed();
+}
+
+// The send gains from rotation only if the instructions between it and the
+// first use of its result don't already cover its latency.
+bool SWPipeliner::isLatencyExposed(G4_BB* bb, INST_LIST_ITER sendIt)
+{
+    G4_INST* send = *sendIt;
+    G4_Declare* dcl = send->getDst()->getTopDcl();
+    unsigned latency = LT.getLatency(send);
+    unsigned cycles = 0;
+
+    for (auto it = std::next(sendIt), ie = bb->end(); it != ie; ++it)
+    {
+        G4_INST* inst = *it;
+        for (int i = 0; i < G4_MAX_SRCS; ++i)
+        {
+            G4_Operand* src = inst->getSrc(i);
+            if (src && !src->isImm() && src->getTopDcl() == dcl)
+            {
+                return cycles < latency;
+            }
+        }
+        cycles += LT.getOccupancy(inst);
+    }
+
+    return false;
+}
+
+// Check that the send may move from its position to the bottom of the body
+// for the next iteration: nothing above it touches its result, its
+// operands, or memory it may alias.
+bool SWPipeliner::canRotate(G4_BB* bb, INST_LIST_ITER sendIt)
+{
+    G4_INST* send = *sendIt;
+    G4_Declare* dcl = send->getDst()->getTopDcl();
+
+    // The result is overwritten one iteration early, so it must not be
+    // live out of the loop.
+    auto dclIt = dclBBs.find(dcl);
+    if (dclIt == dclBBs.end() || dclIt->second.size() != 1 || dclIt->second[0] != bb)
+    {
+        return false;
+    }
+
+    std::vector<G4_Declare*> srcDcls;
+    for (int i = 0; i < G4_MAX_SRCS; ++i)
+    {
+        G4_Operand* src = send->getSrc(i);
+        if (!src || src->isImm())
+        {
+            continue;
+        }
+        G4_Declare* topDcl = src->getTopDcl();
+        if (!topDcl || topDcl == dcl)
+        {
+            return false;
+        }
+        srcDcls.push_back(topDcl);
+    }
+
+    for (auto it = bb->begin(); it != sendIt; ++it)
+    {
+        G4_INST* inst = *it;
+        if (inst->isOptBarrier())
+        {
+            return false;
+        }
+
+        if (inst->isSend())
+        {
+            G4_SendMsgDescriptor* msgDesc = inst->getMsgDesc();
+            if (msgDesc->getAccess() != SendAccess::READ_ONLY ||
+                msgDesc->isFence() || msgDesc->isBarrierMsg())
+            {
+                return false;
+            }
+        }
+
+        G4_DstRegRegion* dst = inst->getDst();
+        if (dst && !dst->isNullReg())
+        {
+            if (dst->isIndirect())
+            {
+                return false;
+            }
+            G4_Declare* topDcl = dst->getTopDcl();
+            if (topDcl == dcl ||
+                std::find(srcDcls.begin(), srcDcls.end(), topDcl) != srcDcls.end())
+            {
+                return false;
+            }
+        }
+
+        for (int i = 0; i < G4_MAX_SRCS; ++i)
+        {
+            G4_Operand* src = inst->getSrc(i);
+            if (src && !src->isImm() && src->getTopDcl() == dcl)
+            {
+                return false;
+            }
+        }
+    }
+
+    for (auto it = std::next(sendIt), ie = bb->end(); it != ie; ++it)
+    {
+        G4_DstRegRegion* dst = (*it)->getDst();
+        if (dst && !dst->isNullReg() &&
+            (dst->isIndirect() || dst->getTopDcl() == dcl))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void SWPipeliner::collectDclBBs()
+{
+    for (auto bb : fg)
+    {
+        auto addRef = [this, bb](G4_Operand* opnd)
+        {
+            if (!opnd || opnd->isImm())
+            {
+                return;
+            }
+            G4_Declare* topDcl = opnd->getTopDcl();
+            if (topDcl)
+            {
+                auto& bbs = dclBBs[topDcl];
+                if (bbs.empty() || bbs.back() != bb)
+                {
+                    bbs.push_back(bb);
+                }
+            }
+        };
+
+        for (auto inst : *bb)
+        {
+            addRef(inst->getDst());
+            for (int i = 0; i < G4_MAX_SRCS; ++i)
+            {
+                addRef(inst->getSrc(i));
+            }
+        }
+    }
+}
+
+void SWPipeliner::rotate(G4_BB* bb, G4_BB* preheader, INST_LIST_ITER sendIt)
+{
+    G4_INST* send = *sendIt;
+    G4_INST* whileInst = bb->back();
+
+    // Prologue: the load for the first iteration.
+    G4_INST* prologue = send->cloneInst();
+    auto pos = preheader->end();
+    if (!preheader->empty() && preheader->back()->isFlowControl())
+    {
+        --pos;
+    }
+    preheader->insert(pos, prologue);
+
+    // Kernel: the load for the next iteration, issued only by the channels
+    // taking the back edge.
+    bb->erase(sendIt);
+    send->setPredicate(builder.createPredicate(*whileInst->getPredicate()));
+    bb->insert(std::prev(bb->end()), send);
+
+    numPipelined++;
+}
+
+void SWPipeliner::pipelineLoop(G4_BB* bb, G4_BB* preheader, RPE& rpe)
+{
+    G4_INST* whileInst = bb->back();
+
+    unsigned maxRP = 0;
+    for (auto inst : *bb)
+    {
+        maxRP = std::max(maxRP, rpe.getRegisterPressure(inst));
+    }
+    unsigned threshold = SWPPressureThreshold * kernel.getNumRegTotal() / 128;
+
+    for (auto it = bb->begin(), ie = bb->end(); it != ie;)
+    {
+        auto cur = it++;
+        G4_INST* inst = *cur;
+        if (!isCandidateSend(inst, whileInst) || !canRotate(bb, cur) ||
+            !isLatencyExposed(bb, cur))
+        {
+            continue;
+        }
+
+        // In the worst case the result is now live across the whole body.
+        unsigned extraRP = inst->getDst()->getTopDcl()->getNumRows();
+        if (maxRP + extraRP > threshold)
+        {
+            continue;
+        }
+
+        rotate(bb, preheader, cur);
+        maxRP += extraRP;
+    }
+}
+
+void SWPipeliner::doSWPipelining()
+{
+    std::vector<std::pair<G4_BB*, G4_BB*>> loops;
+    for (auto bb : fg)
+    {
+        if (!getLoopBranch(bb))
+        {
+            continue;
+        }
+        G4_BB* preheader = getPreheader(bb);
+        if (preheader)
+        {
+            loops.push_back(std::make_pair(bb, preheader));
+        }
+    }
+
+    if (loops.empty())
+    {
+        return;
+    }
+
+    collectDclBBs();
+
+    PointsToAnalysis& p2a = kernel.getPointsToAnalysis();
+    GlobalRA gra(kernel, builder.phyregpool, p2a);
+    gra.markGraphBlockLocalVars();
+    LivenessAnalysis liveness(gra, G4_GRF | G4_INPUT);
+    liveness.computeLiveness();
+    RPE rpe(gra, &liveness);
+    rpe.run();
+
+    for (auto& loop : loops)
+    {
+        pipelineLoop(loop.first, loop.second, rpe);
+    }
+}
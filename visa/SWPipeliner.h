@@ -0,0 +1,97 @@
+/*===================== begin_copyright_notice ==================================
+
+Copyright (c) 2017 Intel Corporation
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+======================= end_copyright_notice ==================================*/
+#ifndef _G4_SWPIPELINER_H_
+#define _G4_SWPIPELINER_H_
+
+#include "Optimizer.h"
+#include "LocalScheduler/LatencyTable.h"
+#include <unordered_map>
+#include <vector>
+
+namespace vISA
+{
+class RPE;
+
+// SWPipeliner overlaps the loads of the next iteration of a single block
+// innermost loop with the current iteration. In a loop like
+//
+//  L:  x = send(a)         // read, a not redefined above it in L
+//      ... uses of x ...
+//      a = a + 64
+//      cmp (P) ...
+//      (P) while L
+//
+// the send is rotated to the bottom of the body, predicated on the loop
+// condition, and a copy of it is peeled into the preheader:
+//
+//      x = send(a)         // prologue
+//  L:  ... uses of x ...
+//      a = a + 64
+//      cmp (P) ...
+//      (P) x = send(a)     // load for the next iteration
+//      (P) while L
+//
+// so that its latency overlaps the back edge and everything up to its
+// first use in the next iteration. This is a modulo schedule with two
+// stages and an initiation interval of one body: channels leaving the
+// loop never issue the extra load, so no epilogue is needed. A send is
+// only rotated when its latency is exposed and when the longer live range
+// of its result keeps the loop under the pressure threshold.
+class SWPipeliner
+{
+private:
+    G4_Kernel& kernel;
+    FlowGraph& fg;
+    IR_Builder& builder;
+    LatencyTable LT;
+    unsigned int numPipelined = 0;
+
+    // The BBs referencing each root declare.
+    std::unordered_map<G4_Declare*, std::vector<G4_BB*>> dclBBs;
+
+    // Loops whose pressure budget is above this are left alone.
+    static const unsigned SWPPressureThreshold = 100;
+
+    G4_BB* getPreheader(G4_BB* bb);
+    G4_INST* getLoopBranch(G4_BB* bb);
+    bool isCandidateSend(G4_INST* inst, G4_INST* whileInst);
+    bool isLatencyExposed(G4_BB* bb, INST_LIST_ITER sendIt);
+    bool canRotate(G4_BB* bb, INST_LIST_ITER sendIt);
+    void collectDclBBs();
+    void rotate(G4_BB* bb, G4_BB* preheader, INST_LIST_ITER sendIt);
+    void pipelineLoop(G4_BB* bb, G4_BB* preheader, RPE& rpe);
+
+public:
+    SWPipeliner(G4_Kernel& k, IR_Builder& irBuilder) :
+        kernel(k), fg(k.fg), builder(irBuilder), LT(&irBuilder)
+    {
+    }
+
+    void doSWPipelining();
+    unsigned int getNumPipelined() { return numPipelined; }
+};
+}
+#endif
@@ -27,6 +27,7 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "SendFusion.h"
 #include "BuildIR.h"
 #include "Gen4_IR.hpp"
+#include "LocalScheduler/LatencyTable.h"
 
 #include <map>
 #include <algorithm>
@@ -40,20 +41,24 @@ namespace vISA
     {
     private:
         enum {
-            // Control if one pair of two sends should be considered for
-            // fusion. If their distance (#instructions) is greater than
-            // SEND_FUSION_MAX_SPAN, it will not be fused.
-            SEND_FUSION_MAX_SPAN = 40,
-
             // Control how many instructions except send itself need to
             // be moved in order to move two sends together for fusion.
-            SEND_FUSION_MAX_INST_TOBEMOVED = 4
+            SEND_FUSION_MAX_INST_TOBEMOVED = 4,
+
+            // Control how much moving a send may extend live ranges, in
+            // GRFs times the number of instructions moved over. Sinking
+            // extends the send's payload, hoisting extends its response.
+            SEND_FUSION_MAX_REG_EXTENSION = 128
         };
 
         FlowGraph* CFG;
         IR_Builder *Builder;
         Mem_Manager* MMgr;
 
+        // Used to decide how far a send can be moved to meet the other
+        // send: the cycles it is moved over must be hidden by its latency.
+        LatencyTable LT;
+
         // BB that is being processed now
         G4_BB* CurrBB;
 
@@ -72,6 +77,10 @@ namespace vISA
         // to be moved (so the size has +1).
         int numToBeSinked;
         int numToBeHoisted;
+        // Live range extension (in GRFs * instructions) caused by the
+        // last canSink()/canHoist() check.
+        int sinkRegCost;
+        int hoistRegCost;
         G4_INST* InstToBeSinked [SEND_FUSION_MAX_INST_TOBEMOVED+1];
         G4_INST* InstToBeHoisted[SEND_FUSION_MAX_INST_TOBEMOVED+1];
 
@@ -99,6 +108,10 @@ namespace vISA
         void doFusion(
             INST_LIST_ITER IT0, INST_LIST_ITER IT1, bool IsSink);
 
+        // Return true if the send at IT could be fused with a send of
+        // the same kind found after one or more read-only sends.
+        bool canSkipOver(G4_INST* Send0, G4_INST* Inst) const;
+
         // Common function for canSink()/canHoist(). It checks if
         // StartIT can sink to EndIT or EndIT can hoist to StartIT
         // based on whether isForward is true or false.
@@ -140,6 +153,7 @@ namespace vISA
             : CFG(aCFG),
               Builder(aCFG->builder),
               MMgr(aMMgr),
+              LT(aCFG->builder),
               CurrBB(nullptr),
               DMaskUD(nullptr),
               FlagDefPerBB(nullptr),
@@ -713,13 +727,26 @@ bool SendFusion::canMoveOver(
     int lid_last = Inst_last->getLocalId();
     assert(lid_first <= lid_last && "Wrong inst position to sink to!");
     int span = lid_last - lid_first;
-    if (span >= SEND_FUSION_MAX_SPAN) {
-        return false;
-    }
 
     bool movable = true;
     G4_INST* moveInst = (isForward ? Inst_first : Inst_last);
     G4_INST* destSend = (isForward ? Inst_last  : Inst_first);
+
+    // Sinking the payload or hoisting the response keeps it alive over
+    // the whole span.
+    G4_SendMsgDescriptor* moveDesc = moveInst->getMsgDesc();
+    int regCost = span * (isForward
+        ? (moveDesc->MessageLength() + moveDesc->extMessageLength())
+        : moveDesc->ResponseLength());
+    (isForward ? sinkRegCost : hoistRegCost) = regCost;
+    if (regCost > SEND_FUSION_MAX_REG_EXTENSION) {
+        return false;
+    }
+
+    // Moving a send over more cycles than its latency hides would delay
+    // either its issue or its result.
+    int latency = LT.getLatency(moveInst);
+    int cycles = 0;
     INST_LIST_ITER II = (isForward ? StartIT : EndIT);
     INST_LIST_ITER IE = (isForward ? EndIT : StartIT);
 
@@ -733,6 +760,12 @@ bool SendFusion::canMoveOver(
          isForward ? ++II : --II)
     {
        G4_INST* tmp = *II;
+       cycles += LT.getOccupancy(tmp);
+       if (cycles > latency)
+       {
+           movable = false;
+           break;
+       }
        for (int i = 0; i < numToBeMoved; ++i)
        {
            // Here check if instToBeMoved and tmp
@@ -1598,6 +1631,18 @@ void SendFusion::doFusion(
     CurrBB->erase(IT1);
 }
 
+bool SendFusion::canSkipOver(G4_INST* Send0, G4_INST* Inst) const
+{
+    // Reads may be reordered with other reads. Anything writing memory,
+    // fences and barriers keep the order of memory accesses.
+    if (!Inst->isSend() || Send0->getMsgDesc()->isDataPortWrite())
+    {
+        return false;
+    }
+    G4_SendMsgDescriptor* desc = Inst->getMsgDesc();
+    return !desc->isDataPortWrite() && !desc->isFence() && !desc->isBarrierMsg();
+}
+
 
 bool SendFusion::run(G4_BB* BB)
 {
@@ -1625,6 +1670,9 @@ bool SendFusion::run(G4_BB* BB)
         G4_INST* inst1 = nullptr;
         INST_LIST_ITER II1 = II0;
         ++II1;
+        // The first send skipped over while looking for inst1, it is where
+        // the search for the next pair starts if inst0 is not fused.
+        INST_LIST_ITER NextII = IE;
         while(II1 != IE)
         {
             G4_INST* tmp = *II1;
@@ -1638,19 +1686,28 @@ bool SendFusion::run(G4_BB* BB)
                     {
                         // Found
                         inst1 = tmp;
+                        break;
                     }
                 }
 
-                // If found (inst1 != null), exit the inner loop to start fusing;
-                // if not found, exit the inner loop and use this one (II1) as
-                // the 1st send of possible next pair to start the outer loop again.
-                //
-                // In both case, don't advance II1.
-                break;
+                // Reads of different kinds are often interleaved, e.g.
+                //   send.A, send.B, send.A, send.B
+                // so keep looking for a match past other reads.
+                if (NextII == IE)
+                {
+                    NextII = II1;
+                }
+                if (!canSkipOver(inst0, tmp))
+                {
+                    break;
+                }
+                ++II1;
+                continue;
             }
 
             ++II1;
-            if (tmp->isSend() || tmp->isOptBarrier())
+            if (tmp->isOptBarrier() ||
+                (tmp->isSend() && !canSkipOver(inst0, tmp)))
             {
                 // Don't try to fusion two sends that are separated
                 // by other memory/barrier instructions.
@@ -1658,40 +1715,71 @@ bool SendFusion::run(G4_BB* BB)
             }
         }
 
+        if (NextII == IE)
+        {
+            NextII = II1;
+        }
+
         if (inst1 == nullptr) {
             // No inst1 found b/w II0 and II1.
-            // Start finding the next candidate from II1
-            II0 = II1;
+            // Start finding the next candidate from the first send
+            // skipped over.
+            II0 = NextII;
             continue;
         }
 
         // At this point, inst0 and inst1 are the pair that can be fused.
         // Now, check if they can be moved to the same position.
         bool sinkable = canSink(II0, II1);
-        bool hoistable = false;
-        if (!sinkable || numToBeSinked > 1)
+        bool hoistable = canHoist(II0, II1);
+        if (sinkable && hoistable)
         {
-            hoistable = canHoist(II0, II1);
-            if (sinkable && hoistable && numToBeHoisted < numToBeSinked)
-            {   // Hoisting as it moves less instructions
-                sinkable = false;
+            // Prefer the direction extending live ranges less, then the
+            // one moving less instructions.
+            if (hoistRegCost != sinkRegCost)
+            {
+                sinkable = sinkRegCost < hoistRegCost;
+            }
+            else
+            {
+                sinkable = numToBeSinked <= numToBeHoisted;
             }
         }
+        // The flag shared by predicated fused sends in this BB must be
+        // defined before the new send, which may not hold for sends that
+        // were skipped over by an earlier fusion.
+        G4_INST* InsertBefore = sinkable ? inst1 : inst0;
+        if (!inst0->isWriteEnableInst() && FlagDefPerBB &&
+            FlagDefPerBB->getLocalId() > InsertBefore->getLocalId())
+        {
+            sinkable = hoistable = false;
+        }
         if (!sinkable && !hoistable)
         {   // Neither sinkable nor hoistable, looking for next candidates.
-            II0 = II1;
+            II0 = NextII;
             continue;
         }
 
-        // Perform fusion (either sink or hoist). It also delete
-        // II0 and II1 after fusion. Thus, need to save ++II1
-        // before invoking doFusion() for the next iteration.
-        INST_LIST_ITER next_II = II1;
-        ++next_II;
+        // Only instructions between II0 and II1 are moved, so the one
+        // before II0 stays in place.
+        bool AtBegin = (II0 == CurrBB->begin());
+        INST_LIST_ITER PrevII = II0;
+        if (!AtBegin)
+        {
+            --PrevII;
+        }
+
+        // Perform fusion (either sink or hoist). It also deletes II0
+        // and II1 after fusion.
         doFusion(II0, II1, sinkable);
+        CurrBB->resetLocalId();
 
         changed = true;
-        II0 = next_II;
+
+        // Rescan from where inst0 was. A send narrower than SIMD8 fused
+        // into a twice wider one may be fused again (N-way fusion), and
+        // the sends skipped over may now find their own match.
+        II0 = AtBegin ? CurrBB->begin() : ++PrevII;
     }
 
     return changed;
@@ -216,6 +216,7 @@ public:
     unsigned long getCodeOffset(){ return m_cisa_kernel.entry; }
 
     CISA_GEN_VAR * getDeclFromName(const std::string &name);
+    CISA_GEN_VAR * getDeclFromVarName(const std::string &name) const;
     bool setNameIndexMap(const std::string &name, CISA_GEN_VAR *, bool unique = false);
     void pushIndexMapScopeLevel();
     void popIndexMapScopeLevel();
@@ -686,6 +687,8 @@ public:
     CM_BUILDER_API std::string getVarName(VISA_SurfaceVar* decl) const;
     CM_BUILDER_API std::string getVarName(VISA_SamplerVar* decl) const;
 
+    CM_BUILDER_API int AppendVISAInlineAsm(const std::string& asmText);
+
     /********** MISC APIs END *************************/
     int CreateVISAPredicateSrcOperand(VISA_VectorOpnd *& opnd, VISA_PredVar *decl, unsigned int size);
 
@@ -24,6 +24,8 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 ======================= end_copyright_notice ==================================*/
 
+#include <set>
+#include <cctype>
 #include <sstream>
 #include <fstream>
 #include <functional>
@@ -198,7 +200,12 @@ int VISAKernelImpl::compileTillOptimize()
 
     Optimizer optimizer(*m_kernelMem, *m_builder, *m_kernel, m_kernel->fg);
 
-    return optimizer.optimization();
+    int status = optimizer.optimization();
+    if (status == CM_SUCCESS && !getIsKernel())
+    {
+        m_kernel->computeCallerSaveClobbers();
+    }
+    return status;
 }
 
 void VISAKernelImpl::createInstsForCallTargetOffset(InstListType& insts, G4_INST* fcall)
@@ -937,6 +944,100 @@ std::string VISAKernelImpl::getVarName(VISA_SamplerVar* decl) const
     return ss.str();
 }
 
+// Returns the declaration getVarName() names 'name' (V<id>, A<id>, P<id>,
+// T<id> or S<id>), or NULL if the name is not of that form.
+CISA_GEN_VAR* VISAKernelImpl::getDeclFromVarName(const std::string& name) const
+{
+    if (name.size() < 2 || name.find_first_not_of("0123456789", 1) != std::string::npos)
+    {
+        return NULL;
+    }
+    int id = atoi(name.c_str() + 1);
+    const std::vector<CISA_GEN_VAR*>* list = NULL;
+    switch (name[0])
+    {
+    case 'V': list = &m_var_info_list; break;
+    case 'A': list = &m_addr_info_list; break;
+    case 'P': list = &m_pred_info_list; id -= COMMON_ISA_NUM_PREDEFINED_PRED; break;
+    case 'T': list = &m_surface_info_list; break;
+    case 'S': list = &m_sampler_info_list; break;
+    default: return NULL;
+    }
+    // Declarations are listed in id order, starting at the id of the first one.
+    if (list->empty() || id < (int)list->front()->index)
+    {
+        return NULL;
+    }
+    size_t pos = id - list->front()->index;
+    if (pos >= list->size() || (int)(*list)[pos]->index != id)
+    {
+        return NULL;
+    }
+    return (*list)[pos];
+}
+
+int VISAKernelImpl::AppendVISAInlineAsm(const std::string& asmText)
+{
+    // Variables created through the builder API are unnamed in the kernel.
+    // Bind each identifier of the fragment that names one of them, either by
+    // its getVarName() name or, for predefined variables, by the name the
+    // parser looks up. A '%' in front of a predefined variable (e.g. %null)
+    // is skipped.
+    for (size_t i = 0; i < asmText.size();)
+    {
+        bool isPredef = asmText[i] == '%' && i + 1 < asmText.size() &&
+            isalpha((unsigned char)asmText[i + 1]);
+        if (!isPredef && !isalpha((unsigned char)asmText[i]) && asmText[i] != '_')
+        {
+            i++;
+            continue;
+        }
+        if (isPredef)
+        {
+            i++;
+        }
+        size_t start = i;
+        while (i < asmText.size() && (isalnum((unsigned char)asmText[i]) || asmText[i] == '_'))
+        {
+            i++;
+        }
+        std::string name = asmText.substr(start, i - start);
+        if (getDeclFromName(name) != NULL)
+        {
+            continue;
+        }
+
+        CISA_GEN_VAR* decl = getDeclFromVarName(name);
+        for (unsigned k = 0; decl == NULL && k < m_num_pred_vars && k < m_var_info_list.size(); k++)
+        {
+            auto predefId = mapExternalToInternalPreDefVar(k);
+            if (predefId != PreDefinedVarsInternal::VAR_LAST &&
+                name == getPredefinedVarString(predefId))
+            {
+                decl = m_var_info_list[k];
+            }
+        }
+        for (unsigned k = 0; decl == NULL && k < Get_CISA_PreDefined_Surf_Count() && k < m_surface_info_list.size(); k++)
+        {
+            if (name == vISAPreDefSurf[k].name)
+            {
+                decl = m_surface_info_list[k];
+            }
+        }
+        if (decl != NULL)
+        {
+            setNameIndexMap(name, decl, true);
+        }
+    }
+
+    std::string text = asmText;
+    if (text.empty() || text.back() != '\n')
+    {
+        text += '\n';
+    }
+    return m_CISABuilder->ParseVISAInlineAsm(this, text);
+}
+
 int VISAKernelImpl::CreateVISAGenVar(VISA_GenVar *& decl, const char *varName, int numberElements, VISA_Type dataType,
                                      VISA_Align varAlign, VISA_GenVar *parentDecl, int aliasOffset)
 {
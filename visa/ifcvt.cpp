@@ -29,6 +29,7 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "ifcvt.h"
 #include "common.h"
 #include "BuildIR.h"
+#include "LocalScheduler/LatencyTable.h"
 
 //#define DEBUG_VERBOSE_ON
 #if defined(DEBUG_VERBOSE_ON)
@@ -41,8 +42,11 @@ using namespace vISA;
 
 namespace {
 
-    const unsigned FullyConvertibleMaxInsts = 5;
-    const unsigned PartialConvertibleMaxInsts = 3;
+    // Upper bounds on the number of instructions predicated per region.
+    // The cost model below decides profitability; these only bound code
+    // growth and the extended live ranges of the predicated values.
+    const unsigned FullyConvertibleMaxInsts = 12;
+    const unsigned PartialConvertibleMaxInsts = 4;
 
     enum IfConvertKind {
         FullConvert,
@@ -93,6 +97,7 @@ namespace {
     // Trivial if-conversion.
     class IfConverter {
         FlowGraph &fg;
+        LatencyTable LT;
 
         /// getSinglePredecessor - Get the single predecessor or null
         /// otherwise.
@@ -265,6 +270,11 @@ namespace {
                 return false;
             }
 
+            // Writing a flag may clobber the predicate guarding the remaining
+            // instructions once the 'if' is gone.
+            if (I->getDst() && I->getDst()->isFlag())
+                return false;
+
             G4_opcode op = I->opcode();
             switch (G4_Inst_Table[op].instType) {
             case InstTypeMov:
@@ -369,9 +379,10 @@ namespace {
         }
 
         /// getPredictableInsts - Return the total number of instructions if
-        /// all instruction in the given BB is predictable. Otherwise, return
-        /// 0.
-        unsigned getPredictableInsts(G4_BB *BB, G4_INST *ifInst) const {
+        /// all instruction in the given BB is predictable and accumulate
+        /// their issue cost into 'cost'. Otherwise, return 0.
+        unsigned getPredictableInsts(G4_BB *BB, G4_INST *ifInst,
+                                     unsigned &cost) const {
             ASSERT_USER(ifInst->opcode() == G4_if ||
                         ifInst->opcode() == G4_goto,
                         "Either 'if' or 'goto' is expected!");
@@ -417,12 +428,65 @@ namespace {
                 if (!isPredictable(I, ifInst)) {
                     return 0;
                 }
+                cost += LT.getOccupancy(I);
                 ++sum;
             }
 
             return sum;
         }
 
+        /// getBranchCost - Return the latency of the control-flow
+        /// instructions in the given BB, which are all removed once it is
+        /// predicated.
+        unsigned getBranchCost(G4_BB *BB) const {
+            unsigned cost = 0;
+            for (auto *I : *BB)
+                if (I->isFlowControl())
+                    cost += LT.getLatency(I);
+            return cost;
+        }
+
+        /// getEndifCost - Return the latency of the 'endif' or 'join'
+        /// starting the given tail BB, if any.
+        unsigned getEndifCost(G4_BB *BB) const {
+            auto I = BB->begin();
+            if (I != BB->end() && (*I)->opcode() == G4_label)
+                ++I;
+            if (I == BB->end())
+                return 0;
+            G4_opcode op = (*I)->opcode();
+            if (op != G4_endif && op != G4_join)
+                return 0;
+            return LT.getLatency(*I);
+        }
+
+        /// isProfitable - Check whether predicating arms with the total
+        /// issue cost 'cost' beats keeping the branch instructions of the
+        /// latency 'branchCost'. Predicated, both arms are always issued.
+        /// With the branch, divergent channels issue both arms as well while
+        /// a uniform branch issues half of them on average. Assuming both
+        /// cases are equally likely, the branchy form costs
+        /// 'branchCost + 3/4 * cost', i.e. predication wins as long as the
+        /// arms cost no more than 4x the branches they replace. Loops scale
+        /// both sides equally and need no special treatment.
+        bool isProfitable(unsigned cost, unsigned branchCost,
+                          unsigned numInsts, unsigned maxInsts) const {
+            return numInsts > 0 && numInsts <= maxInsts &&
+                   cost <= 4 * branchCost;
+        }
+
+        /// writesFlag - Check whether any instruction in the given BB
+        /// updates a flag register.
+        bool writesFlag(G4_BB *BB) const {
+            for (auto *I : *BB) {
+                if (I->getCondMod())
+                    return true;
+                if (I->getDst() && I->getDst()->isFlag())
+                    return true;
+            }
+            return false;
+        }
+
         /// reversePredicate - Reverse the predicate state.
         void reversePredicate(G4_Predicate *pred) const {
             G4_PredState state = pred->getState();
@@ -467,7 +531,7 @@ namespace {
         void partialConvert(IfConvertible &);
 
     public:
-        IfConverter(FlowGraph &g) : fg(g) {}
+        IfConverter(FlowGraph &g) : fg(g), LT(g.builder) {}
 
         void analyze(std::vector<IfConvertible> &);
 
@@ -498,25 +562,48 @@ void IfConverter::analyze(std::vector<IfConvertible> &list) {
 
         G4_Predicate *pred = ifInst->getPredicate();
 
-        unsigned n0 = getPredictableInsts(s0, ifInst);
-        unsigned n1 = s1 ? getPredictableInsts(s1, ifInst) : 0;
+        unsigned c0 = 0, c1 = 0;
+        unsigned n0 = getPredictableInsts(s0, ifInst, c0);
+        unsigned n1 = s1 ? getPredictableInsts(s1, ifInst, c1) : 0;
+
+        unsigned ifCost = LT.getLatency(ifInst);
+        unsigned endifCost = getEndifCost(t);
 
         if (s0 && s1) {
-            if (((n0 > 0) && (n0 < FullyConvertibleMaxInsts)) &&
-                ((n1 > 0) && (n1 < FullyConvertibleMaxInsts))) {
+            unsigned fullBranchCost =
+                ifCost + getBranchCost(s0) + getBranchCost(s1) + endifCost;
+            if (n0 > 0 && n1 > 0 &&
+                isProfitable(c0 + c1, fullBranchCost, n0 + n1,
+                             FullyConvertibleMaxInsts)) {
                 // Both 'if' and 'else' are profitable to be if-converted.
                 list.push_back(
                     IfConvertible(FullConvert, pred, BB, s0, s1, t));
-            } else if ((n0 > 0) && (n0 < PartialConvertibleMaxInsts)) {
+                continue;
+            }
+
+            // Partial conversion is only done on structured 'if-else-endif'
+            // and only removes the 'else' instruction.
+            if (ifInst->opcode() != G4_if || s0->empty() ||
+                s0->back()->opcode() != G4_else)
+                continue;
+            unsigned elseCost = LT.getLatency(s0->back());
+
+            if (isProfitable(c0, elseCost, n0, PartialConvertibleMaxInsts)) {
                 // Only 'if' is profitable to be converted.
                 list.push_back(
                     IfConvertible(PartialIfConvert, pred, BB, s0, s1, t));
-            } else if ((n1 > 0) && (n1 < PartialConvertibleMaxInsts)) {
-                // Only 'else' is profitable to be converted.
+            } else if (t->Preds.size() == 2 && !writesFlag(s0) &&
+                       isProfitable(c1, elseCost, n1,
+                                    PartialConvertibleMaxInsts)) {
+                // Only 'else' is profitable to be converted. Its predicated
+                // instructions are sunk into the tail, which therefore must
+                // not be reached from elsewhere and must still see the
+                // predicate unchanged by the 'if' branch.
                 list.push_back(
                     IfConvertible(PartialElseConvert, pred, BB, s0, s1, t));
             }
-        } else if ((n0 > 0) && (n0 < FullyConvertibleMaxInsts)) {
+        } else if (isProfitable(c0, ifCost + getBranchCost(s0) + endifCost,
+                                n0, FullyConvertibleMaxInsts)) {
             list.push_back(
                 IfConvertible(FullConvert, pred, BB, s0, nullptr, t));
         }
@@ -645,7 +732,83 @@ void IfConverter::fullConvert(IfConvertible &IC) {
 }
 
 void IfConverter::partialConvert(IfConvertible &IC) {
-    // TODO: Add partial if-conversion support.
+    G4_Predicate &pred = *IC.pred;
+    G4_BB *head = IC.head;
+    G4_BB *tail = IC.tail;
+    G4_BB *s0 = IC.succIf;
+    G4_BB *s1 = IC.succElse;
+
+    INST_LIST_ITER pos = std::prev(head->end());
+    G4_INST *ifInst = *pos;
+    ASSERT_USER(ifInst->opcode() == G4_if,
+                "Partially convertible if is not started with 'if'!");
+    ASSERT_USER(s0->back()->opcode() == G4_else,
+                "Partially convertible if has no 'else'!");
+
+    if (IC.kind == PartialIfConvert) {
+        // Hoist the predicated 'if' branch into head and let the 'if'
+        // guard the 'else' branch only, i.e.
+        //
+        //  (+P) if                     (+P) BB1
+        //      BB1                 =>  (-P) if
+        //  else                            BB2
+        //      BB2                     endif
+        //  endif
+        //
+        for (/* EMPTY */; !s0->empty(); s0->pop_front()) {
+            auto I = s0->front();
+            G4_opcode op = I->opcode();
+            if (op == G4_label || op == G4_else)
+                continue;
+            I->setPredicate(fg.builder->createPredicate(pred));
+            head->insert(pos, I);
+        }
+        markEmptyBB(fg.builder, s0);
+
+        // 's0' is now an empty block falling through into 's1'.
+        fg.removePredSuccEdges(head, s1);
+        fg.removePredSuccEdges(s0, tail);
+        fg.addPredSuccEdges(s0, s1);
+    } else {
+        // Sink the predicated 'else' branch into tail, right after the
+        // 'endif', so that it still follows the 'if' branch, i.e.
+        //
+        //  (+P) if                     (+P) if
+        //      BB1                         BB1
+        //  else                =>      endif
+        //      BB2                     (-P) BB2
+        //  endif
+        //
+        INST_LIST_ITER tpos = tail->begin();
+        ASSERT_USER((*tpos)->opcode() == G4_label,
+                    "BB is not started with 'label'!");
+        ++tpos;
+        ASSERT_USER(tpos != tail->end() && (*tpos)->opcode() == G4_endif,
+                    "Convertible if is not ended with 'endif'!");
+        ++tpos;
+
+        for (/* EMPTY */; !s1->empty(); s1->pop_front()) {
+            auto I = s1->front();
+            if (I->opcode() == G4_label)
+                continue;
+            G4_Predicate *negPred = fg.builder->createPredicate(pred);
+            reversePredicate(negPred);
+            I->setPredicate(negPred);
+            tail->insert(tpos, I);
+        }
+        markEmptyBB(fg.builder, s1);
+        s0->pop_back();
+
+        // 's1' is now an empty block between 's0' and tail.
+        fg.removePredSuccEdges(head, s1);
+        fg.removePredSuccEdges(s1, tail);
+    }
+
+    // Without 'else', the 'if' jumps straight to its 'endif'.
+    if (IC.kind == PartialIfConvert)
+        reversePredicate(ifInst->getPredicate());
+    ifInst->asCFInst()->setJip(ifInst->asCFInst()->getUip());
+    fg.addPredSuccEdges(head, tail, false);
 }
 
 void runIfCvt(FlowGraph &fg) {
@@ -778,6 +778,11 @@ public:
     CM_BUILDER_API virtual std::string getVarName(VISA_SurfaceVar* decl) const = 0;
     CM_BUILDER_API virtual std::string getVarName(VISA_SamplerVar* decl) const = 0;
 
+    /// AppendVISAInlineAsm -- parses a fragment of visaasm instructions and appends
+    /// them to this kernel. Existing variables are referred to by their getVarName()
+    /// names, so the rest of the kernel does not go through the text parser.
+    CM_BUILDER_API virtual int AppendVISAInlineAsm(const std::string& asmText) = 0;
+
 };
 
 class VISAFunction : public VISAKernel